@@ -0,0 +1,552 @@
+/*
+ * dlist.c
+ *
+ * Display list of a frame.
+ */
+
+#include "dlist.h"
+#include "font.h"
+
+#define DL_FILL_BATCH	32	/**< @brief Consecutive fills handed to vg_fill_rects() at once */
+
+/** @name Command kinds */
+/**@{
+ *
+ * Drawing operations of the display list
+ */
+enum {
+	DL_FILL,
+	DL_LINE,
+	DL_CHAR,
+	DL_NUMBER,
+	DL_RUNS,
+	DL_BLIT
+};
+/**@} end of Command kinds */
+
+/** @name Command */
+/**@{
+ *
+ * Recorded drawing operation; unused fields are zero, so commands compare with memcmp()
+ */
+typedef struct {
+	unsigned char kind;		/**< @brief one of the command kinds */
+	char symbol;			/**< @brief char or digit of a glyph */
+	unsigned short size;	/**< @brief size of a glyph */
+	unsigned int color;		/**< @brief color of a fill, line or glyph */
+	int x1;					/**< @brief fill's x1, line's xi, or x */
+	int y1;					/**< @brief fill's y1, line's yi, or y */
+	int x2;					/**< @brief fill's x2 or line's xf */
+	int y2;					/**< @brief fill's y2 or line's yf */
+	const void *data;		/**< @brief runs, surface, or glyph cache entry */
+	unsigned long version;	/**< @brief version of a surface's contents or of a glyph cache entry */
+	vg_rect_t box;			/**< @brief pixels the command may change */
+} DL_COMMAND;
+/**@} end of Command */
+
+static DL_COMMAND lists[2][DL_MAX_COMMANDS];	/**< @brief Commands of this frame and of the previous one */
+static DL_COMMAND *current = lists[0];			/**< @brief Frame being recorded */
+static DL_COMMAND *previous = lists[1];			/**< @brief Last frame drawn */
+static unsigned int current_count = 0;			/**< @brief Commands in current */
+static unsigned int previous_count = 0;			/**< @brief Commands in previous */
+static int recording = 0;						/**< @brief Commands are recorded instead of drawn */
+static int previous_valid = 0;					/**< @brief The video buffer holds the previous frame */
+static dl_stats_t stats;						/**< @brief Counters of the last frame */
+
+static int rect_overlap(const vg_rect_t *a, const vg_rect_t *b) {
+	return (a->x1 < b->x2) && (b->x1 < a->x2) && (a->y1 < b->y2) && (b->y1 < a->y2);
+}
+
+static long rect_area(const vg_rect_t *r) {
+	return (long)(r->x2 - r->x1) * (long)(r->y2 - r->y1);
+}
+
+static void rect_union(vg_rect_t *dst, const vg_rect_t *a, const vg_rect_t *b) {
+	dst->x1 = (a->x1 < b->x1) ? a->x1 : b->x1;
+	dst->y1 = (a->y1 < b->y1) ? a->y1 : b->y1;
+	dst->x2 = (a->x2 > b->x2) ? a->x2 : b->x2;
+	dst->y2 = (a->y2 > b->y2) ? a->y2 : b->y2;
+}
+
+static void set_box(DL_COMMAND *cmd, int x1, int y1, int x2, int y2) {
+	cmd->box.x1 = x1;
+	cmd->box.y1 = y1;
+	cmd->box.x2 = x2;
+	cmd->box.y2 = y2;
+}
+
+/**
+ * @brief Draw a list of commands, each one only if it may change region.
+ *
+ * Runs of fills go to vg_fill_rects() together.
+ *
+ * @param list commands to draw
+ * @param count number of commands
+ * @param region region being drawn again, NULL for everything
+ */
+static int execute(const DL_COMMAND *list, unsigned int count, const vg_rect_t *region) {
+	vg_fill_t fills[DL_FILL_BATCH];
+	unsigned int i, batch = 0;
+	const DL_COMMAND *cmd;
+	const vg_runs_t *runs;
+	font_glyph_t glyph;
+	int ret = 0;
+
+	for(i = 0; i < count; i++) {
+		cmd = &list[i];
+		if((region != NULL) && !rect_overlap(&cmd->box, region)) {
+			continue;
+		}
+		stats.executed++;
+
+		if(cmd->kind == DL_FILL) {
+			fills[batch].rect.x1 = cmd->x1;
+			fills[batch].rect.y1 = cmd->y1;
+			fills[batch].rect.x2 = cmd->x2;
+			fills[batch].rect.y2 = cmd->y2;
+			fills[batch].color = cmd->color;
+			if(++batch < DL_FILL_BATCH) {
+				continue;
+			}
+		}
+		if(batch > 0) {
+			ret |= vg_fill_rects(fills, batch);
+			batch = 0;
+		}
+
+		switch(cmd->kind) {
+		case DL_LINE:
+			ret |= vg_draw_line(cmd->x1, cmd->y1, cmd->x2, cmd->y2, cmd->color);
+			break;
+		case DL_CHAR:
+		case DL_NUMBER:
+			/* the glyph recorded with the command, unless the cache has reused its entry since */
+			glyph.entry = cmd->data;
+			glyph.version = cmd->version;
+			if((runs = font_glyph_runs(&glyph)) != NULL) {
+				ret |= vg_draw_runs(cmd->x1, cmd->y1, runs);
+			}
+			else if(cmd->kind == DL_CHAR) {
+				ret |= (font_draw_char(cmd->x1, cmd->y1, cmd->color, cmd->symbol, cmd->size) == -1) ? -1 : 0;
+			}
+			else {
+				ret |= (font_draw_number(cmd->x1, cmd->y1, cmd->color, cmd->symbol, cmd->size) == -1) ? -1 : 0;
+			}
+			break;
+		case DL_RUNS:
+			ret |= vg_draw_runs(cmd->x1, cmd->y1, cmd->data);
+			break;
+		case DL_BLIT:
+			ret |= vg_blit_surface(cmd->data, cmd->x1, cmd->y1);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if(batch > 0) {
+		ret |= vg_fill_rects(fills, batch);
+	}
+
+	return (ret != 0) ? -1 : 0;
+}
+
+/**
+ * @brief Get a new command of the frame being recorded.
+ *
+ * @return zeroed command, NULL if it must be drawn immediately
+ */
+static DL_COMMAND *append(unsigned char kind) {
+	DL_COMMAND *cmd;
+
+	if(!recording) {
+		previous_valid = 0;
+		return NULL;
+	}
+
+	if(current_count == DL_MAX_COMMANDS) {
+		/* draw what was recorded and the rest of the frame immediately */
+		execute(current, current_count, NULL);
+		recording = 0;
+		previous_valid = 0;
+		return NULL;
+	}
+
+	cmd = &current[current_count++];
+	memset(cmd, 0, sizeof(DL_COMMAND));
+	cmd->kind = kind;
+
+	return cmd;
+}
+
+/**
+ * @brief Merge each fill with the previous command when both fills of one color make a rectangle.
+ */
+static void merge_fills() {
+	unsigned int i, kept = 0;
+	DL_COMMAND *a, *b;
+
+	for(i = 1; i < current_count; i++) {
+		a = &current[kept];
+		b = &current[i];
+		if((a->kind == DL_FILL) && (b->kind == DL_FILL) && (a->color == b->color) &&
+				(((a->y1 == b->y1) && (a->y2 == b->y2) && ((a->x2 == b->x1) || (b->x2 == a->x1))) ||
+				((a->x1 == b->x1) && (a->x2 == b->x2) && ((a->y2 == b->y1) || (b->y2 == a->y1))))) {
+			rect_union(&a->box, &a->box, &b->box);
+			a->x1 = a->box.x1;
+			a->y1 = a->box.y1;
+			a->x2 = a->box.x2;
+			a->y2 = a->box.y2;
+			stats.merged++;
+			continue;
+		}
+		current[++kept] = *b;
+	}
+
+	if(current_count > 0) {
+		current_count = kept + 1;
+	}
+}
+
+/**
+ * @brief Move each glyph next to the glyph before it, when nothing in between overlaps it.
+ */
+static void group_glyphs() {
+	unsigned int i, k;
+	DL_COMMAND glyph;
+
+	for(i = 1; i < current_count; i++) {
+		if((current[i].kind != DL_CHAR) && (current[i].kind != DL_NUMBER)) {
+			continue;
+		}
+		for(k = i; k > 0; k--) {
+			if((current[k - 1].kind == DL_CHAR) || (current[k - 1].kind == DL_NUMBER) ||
+					rect_overlap(&current[k - 1].box, &current[i].box)) {
+				break;
+			}
+		}
+		if((k > 0) && (k < i) && ((current[k - 1].kind == DL_CHAR) || (current[k - 1].kind == DL_NUMBER))) {
+			glyph = current[i];
+			memmove(&current[k + 1], &current[k], (i - k) * sizeof(DL_COMMAND));
+			current[k] = glyph;
+		}
+	}
+}
+
+/**
+ * @brief Add a box to the changed regions, merging it with the regions it overlaps.
+ */
+static void add_region(vg_rect_t regions[], unsigned int *count, const vg_rect_t *box) {
+	vg_rect_t r = *box, u;
+	unsigned int i, best = 0;
+	long growth, best_growth = -1;
+
+	if((r.x1 >= r.x2) || (r.y1 >= r.y2)) {
+		return;
+	}
+
+	for(i = 0; i < *count; ) {
+		if(rect_overlap(&regions[i], &r)) {
+			rect_union(&r, &r, &regions[i]);
+			regions[i] = regions[--(*count)];
+			i = 0;
+			continue;
+		}
+		i++;
+	}
+
+	if(*count < DL_MAX_REGIONS) {
+		regions[(*count)++] = r;
+		return;
+	}
+
+	for(i = 0; i < *count; i++) {
+		rect_union(&u, &regions[i], &r);
+		growth = rect_area(&u) - rect_area(&regions[i]);
+		if((best_growth < 0) || (growth < best_growth)) {
+			best_growth = growth;
+			best = i;
+		}
+	}
+	rect_union(&regions[best], &regions[best], &r);
+}
+
+/**
+ * @brief Find the regions changed since the previous frame.
+ *
+ * Commands are matched in order; the boxes of commands of either frame left
+ * without a match are the changed regions.
+ *
+ * @return number of regions
+ */
+static unsigned int diff(vg_rect_t regions[]) {
+	unsigned int i, j, k, next = 0, count = 0;
+
+	stats.changed = 0;
+
+	for(i = 0; i < current_count; i++) {
+		for(j = next; (j < previous_count) && (j < next + DL_MATCH_WINDOW); j++) {
+			if(memcmp(&current[i], &previous[j], sizeof(DL_COMMAND)) == 0) {
+				break;
+			}
+		}
+		if((j < previous_count) && (j < next + DL_MATCH_WINDOW)) {
+			for(k = next; k < j; k++) {
+				add_region(regions, &count, &previous[k].box);
+				stats.changed++;
+			}
+			next = j + 1;
+		}
+		else {
+			add_region(regions, &count, &current[i].box);
+			stats.changed++;
+		}
+	}
+	for(k = next; k < previous_count; k++) {
+		add_region(regions, &count, &previous[k].box);
+		stats.changed++;
+	}
+
+	return count;
+}
+
+void dl_begin() {
+	current_count = 0;
+	recording = 1;
+	stats.commands = 0;
+	stats.merged = 0;
+	stats.changed = 0;
+	stats.regions = 0;
+	stats.executed = 0;
+	stats.full = 0;
+}
+
+int dl_end() {
+	vg_rect_t regions[DL_MAX_REGIONS], clip;
+	unsigned int i, count;
+	DL_COMMAND *t;
+	long area = 0;
+	int ret = 0;
+
+	if(!recording) {
+		return 0;
+	}
+	recording = 0;
+
+	stats.commands = current_count;
+	merge_fills();
+	group_glyphs();
+
+	vg_get_clip(&clip);
+
+	count = previous_valid ? diff(regions) : 0;
+	for(i = 0; i < count; i++) {
+		area += rect_area(&regions[i]);
+	}
+
+	if(!previous_valid || (100 * area > (long)DL_FULL_PERCENT * rect_area(&clip))) {
+		stats.full = 1;
+		stats.regions = 1;
+		ret = execute(current, current_count, NULL);
+	}
+	else if(count == 0) {
+		stats.identical++;
+	}
+	else {
+		stats.regions = count;
+		for(i = 0; i < count; i++) {
+			vg_set_clip(&regions[i]);
+			ret |= execute(current, current_count, &regions[i]);
+		}
+		vg_set_clip(&clip);
+	}
+
+	t = previous;
+	previous = current;
+	current = t;
+	previous_count = current_count;
+	current_count = 0;
+	previous_valid = (ret == 0);
+
+	return ret;
+}
+
+void dl_abort() {
+	recording = 0;
+	current_count = 0;
+	previous_valid = 0;
+}
+
+void dl_invalidate() {
+	previous_valid = 0;
+}
+
+int dl_fill(int x1, int y1, int x2, int y2, unsigned int color) {
+	DL_COMMAND *cmd = append(DL_FILL);
+
+	if(cmd == NULL) {
+		return vg_fill_rect(x1, y1, x2, y2, color);
+	}
+
+	cmd->x1 = x1;
+	cmd->y1 = y1;
+	cmd->x2 = x2;
+	cmd->y2 = y2;
+	cmd->color = color;
+	set_box(cmd, x1, y1, x2, y2);
+
+	return 0;
+}
+
+int dl_fills(const vg_fill_t *fills, unsigned int count) {
+	unsigned int i;
+
+	for(i = 0; i < count; i++) {
+		if(dl_fill(fills[i].rect.x1, fills[i].rect.y1, fills[i].rect.x2, fills[i].rect.y2, fills[i].color) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int dl_line(int xi, int yi, int xf, int yf, unsigned int color) {
+	DL_COMMAND *cmd = append(DL_LINE);
+
+	if(cmd == NULL) {
+		return vg_draw_line(xi, yi, xf, yf, color);
+	}
+
+	cmd->x1 = xi;
+	cmd->y1 = yi;
+	cmd->x2 = xf;
+	cmd->y2 = yf;
+	cmd->color = color;
+	set_box(cmd, (xi < xf) ? xi : xf, (yi < yf) ? yi : yf, ((xi > xf) ? xi : xf) + 1, ((yi > yf) ? yi : yf) + 1);
+
+	return 0;
+}
+
+int dl_rectangle(int xi, int yi, int xf, int yf, unsigned int color) {
+	if((dl_line(xi, yi, xf, yi, color) == -1) || (dl_line(xi, yf, xf, yf, color) == -1) ||
+			(dl_line(xi, yi, xi, yf, color) == -1) || (dl_line(xf, yi, xf, yf, color) == -1)) {
+		return -1;
+	}
+	return 0;
+}
+
+int dl_square(int xi, int yi, int size, unsigned int color) {
+	if(!size) {
+		return -2;
+	}
+	return dl_rectangle(xi, yi, xi + size, yi + size, color);
+}
+
+/**
+ * @brief Record a char or digit already looked up in the glyph cache.
+ *
+ * @return 0 if success, -1 otherwise
+ */
+static int record_glyph(unsigned char kind, int x, int y, unsigned int color, char symbol, unsigned int size, const font_glyph_t *glyph) {
+	unsigned int width, height;
+	const vg_runs_t *runs;
+	DL_COMMAND *cmd;
+
+	if((cmd = append(kind)) == NULL) {
+		if((runs = font_glyph_runs(glyph)) != NULL) {
+			return vg_draw_runs(x, y, runs);
+		}
+		if(kind == DL_CHAR) {
+			return (font_draw_char(x, y, color, symbol, size) == -1) ? -1 : 0;
+		}
+		return (font_draw_number(x, y, color, symbol, size) == -1) ? -1 : 0;
+	}
+
+	cmd->x1 = x;
+	cmd->y1 = y;
+	cmd->color = color;
+	cmd->symbol = symbol;
+	cmd->size = size;
+	cmd->data = glyph->entry;
+	cmd->version = glyph->version;
+	if(kind == DL_CHAR) {
+		vg_char_extent(size, &width, &height);
+	}
+	else {
+		vg_number_extent(size, &width, &height);
+	}
+	set_box(cmd, x, y, x + width, y + height);
+
+	return 0;
+}
+
+int dl_char(int x, int y, unsigned int color, char symbol, unsigned int size) {
+	font_glyph_t glyph;
+	int advance;
+
+	if(!recording) {
+		previous_valid = 0;
+		return font_draw_char(x, y, color, symbol, size);
+	}
+
+	if((advance = font_lookup_char(color, symbol, size, &glyph)) == -1) {
+		return -1;
+	}
+
+	return (record_glyph(DL_CHAR, x, y, color, symbol, size, &glyph) == -1) ? -1 : advance;
+}
+
+int dl_number(int x, int y, unsigned int color, unsigned long digit, unsigned int size) {
+	font_glyph_t glyph;
+	int advance;
+
+	if(!recording) {
+		previous_valid = 0;
+		return font_draw_number(x, y, color, digit, size);
+	}
+
+	if((advance = font_lookup_number(color, digit, size, &glyph)) == -1) {
+		return -1;
+	}
+
+	return (record_glyph(DL_NUMBER, x, y, color, digit, size, &glyph) == -1) ? -1 : advance;
+}
+
+int dl_glyph(int x, int y, unsigned int color, char symbol, unsigned int size, const font_glyph_t *glyph) {
+	return record_glyph(DL_CHAR, x, y, color, symbol, size, glyph);
+}
+
+int dl_runs(int x, int y, const vg_runs_t *image) {
+	DL_COMMAND *cmd = append(DL_RUNS);
+
+	if(cmd == NULL) {
+		return vg_draw_runs(x, y, image);
+	}
+
+	cmd->x1 = x;
+	cmd->y1 = y;
+	cmd->data = image;
+	set_box(cmd, x, y, x + image->width * vg_get_render_scale(), y + image->height * vg_get_render_scale());
+
+	return 0;
+}
+
+int dl_blit(const vg_surface_t *surface, int x, int y, unsigned long version) {
+	DL_COMMAND *cmd = append(DL_BLIT);
+
+	if(cmd == NULL) {
+		return vg_blit_surface(surface, x, y);
+	}
+
+	cmd->x1 = x;
+	cmd->y1 = y;
+	cmd->data = surface;
+	cmd->version = version;
+	set_box(cmd, x, y, x + surface->width * vg_get_render_scale(), y + surface->height * vg_get_render_scale());
+
+	return 0;
+}
+
+const dl_stats_t *dl_get_stats() {
+	return &stats;
+}
@@ -0,0 +1,129 @@
+#ifndef DLIST_H_
+#define DLIST_H_
+
+#include "libraries.h"
+#include "video_gr.h"
+#include "font.h"
+
+/** @defgroup dlist dlist
+ * @{
+ *
+ * Display list: frames are recorded as commands, batched, compared with the
+ * previous frame and only the regions that changed are drawn again.
+ *
+ * Outside of dl_begin() / dl_end() every command is drawn immediately.
+ */
+
+#define DL_MAX_COMMANDS		1024	/**< @brief Commands recorded per frame; a longer frame is drawn immediately */
+#define DL_MAX_REGIONS		8		/**< @brief Changed regions redrawn per frame; further ones are merged into the closest */
+#define DL_FULL_PERCENT		75		/**< @brief Changed screen percentage above which the whole list is drawn */
+#define DL_MATCH_WINDOW		64		/**< @brief How far ahead in the previous frame a command is looked for */
+
+/** @name Display List Stats */
+/**@{
+ *
+ * Counters of the last frame
+ */
+typedef struct {
+	unsigned int commands;		/**< @brief commands recorded */
+	unsigned int merged;		/**< @brief fills merged into a neighbour */
+	unsigned int changed;		/**< @brief commands not found in the previous frame, in either frame */
+	unsigned int regions;		/**< @brief regions drawn again, 0 for an identical frame */
+	unsigned int executed;		/**< @brief commands executed, counting once per region */
+	unsigned int full;			/**< @brief the whole list was drawn */
+	unsigned long identical;	/**< @brief frames skipped since dl_begin() was first called */
+} dl_stats_t;
+/** @} end of Display List Stats */
+
+/**
+ * @brief Start recording a frame. A frame already being recorded is discarded.
+ *
+ * A frame must draw every pixel it depends on, e.g. starting with a fill of the screen.
+ */
+void dl_begin();
+/**
+ * @brief Stop recording and draw what changed since the previous frame.
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int dl_end();
+/**
+ * @brief Stop recording without drawing, and forget the previous frame.
+ */
+void dl_abort();
+/**
+ * @brief Forget the previous frame, so the next one is drawn whole.
+ *
+ * Needed when the video buffer is drawn to by other means.
+ */
+void dl_invalidate();
+/**
+ * @brief Fill a rectangle. Same as vg_fill_rect().
+ */
+int dl_fill(int x1, int y1, int x2, int y2, unsigned int color);
+/**
+ * @brief Fill several rectangles. Same as vg_fill_rects().
+ */
+int dl_fills(const vg_fill_t *fills, unsigned int count);
+/**
+ * @brief Draw a line. Same as vg_draw_line().
+ */
+int dl_line(int xi, int yi, int xf, int yf, unsigned int color);
+/**
+ * @brief Draw the outline of a rectangle. Same as vg_draw_rectangle().
+ */
+int dl_rectangle(int xi, int yi, int xf, int yf, unsigned int color);
+/**
+ * @brief Draw the outline of a square. Same as vg_draw_square().
+ */
+int dl_square(int xi, int yi, int size, unsigned int color);
+/**
+ * @brief Draw a char through the glyph cache. Same as font_draw_char().
+ *
+ * @return horizontal advance of the char, -1 on error
+ */
+int dl_char(int x, int y, unsigned int color, char symbol, unsigned int size);
+/**
+ * @brief Draw a digit through the glyph cache. Same as font_draw_number().
+ *
+ * @return value returned by font_draw_number(), -1 on error
+ */
+int dl_number(int x, int y, unsigned int color, unsigned long digit, unsigned int size);
+/**
+ * @brief Draw a char already looked up with font_lookup_char(), without looking it up again.
+ *
+ * @param x char's x coordinate (left)
+ * @param y char's y coordinate (top)
+ * @param color color the char was looked up in
+ * @param symbol char that was looked up
+ * @param size size the char was looked up in
+ * @param glyph glyph returned by the lookup; if its cache entry is reused, the char is drawn by its symbol
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int dl_glyph(int x, int y, unsigned int color, char symbol, unsigned int size, const font_glyph_t *glyph);
+/**
+ * @brief Draw runs. Same as vg_draw_runs().
+ *
+ * The runs must not change while they are in use by the display list.
+ */
+int dl_runs(int x, int y, const vg_runs_t *image);
+/**
+ * @brief Copy a surface. Same as vg_blit_surface().
+ *
+ * @param surface surface to copy
+ * @param x surface's x coordinate (left)
+ * @param y surface's y coordinate (top)
+ * @param version changes whenever the surface's contents change
+ */
+int dl_blit(const vg_surface_t *surface, int x, int y, unsigned long version);
+/**
+ * @brief Get the counters of the last frame.
+ *
+ * @return pointer to the counters
+ */
+const dl_stats_t *dl_get_stats();
+
+/** @} end of dlist */
+
+#endif /* DLIST_H_ */
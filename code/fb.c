@@ -0,0 +1,14 @@
+/*
+ * fb.c
+ *
+ * Display side of a present on a VBE adapter.
+ */
+
+#include "fb.h"
+
+void fb_present_begin() {
+	/* VRAM is shown as it is written */
+}
+
+void fb_present_end() {
+}
@@ -0,0 +1,27 @@
+#ifndef FB_H_
+#define FB_H_
+
+#include "libraries.h"
+
+/** @defgroup fb fb
+ * @{
+ *
+ * Display side of a present, around the copy of the video buffer to VRAM.
+ *
+ * On Minix the adapter scans VRAM out on its own and there is nothing to do
+ * (fb.c). Host builds link host/fb_shm.c instead, which publishes each
+ * presented frame in a shared memory segment for an external viewer.
+ */
+
+/**
+ * @brief Called before the video buffer is copied to VRAM.
+ */
+void fb_present_begin();
+/**
+ * @brief Called once the frame is in VRAM, to show it.
+ */
+void fb_present_end();
+
+/** @} end of fb */
+
+#endif /* FB_H_ */
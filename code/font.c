@@ -0,0 +1,383 @@
+/*
+ * font.c
+ *
+ * Glyph cache for the segment font.
+ */
+
+#include "font.h"
+#include "video_gr.h"
+
+/** @name Glyph kinds */
+/**@{
+ *
+ * Glyphs drawn by vg_draw_char() and by vg_draw_number()
+ */
+enum {
+	GLYPH_CHAR,
+	GLYPH_NUMBER
+};
+/**@} end of Glyph kinds */
+
+/** @name Glyph */
+/**@{
+ *
+ * Cached glyph, stored as its opaque runs
+ */
+typedef struct {
+	int valid;				/**< @brief entry in use */
+	unsigned long version;	/**< @brief value of versions when the glyph was rasterized */
+	unsigned long last_use;	/**< @brief value of use_clock on the last hit */
+	char symbol;			/**< @brief char or digit */
+	unsigned char kind;		/**< @brief GLYPH_CHAR or GLYPH_NUMBER */
+	unsigned int size;		/**< @brief glyph size */
+	unsigned int color;		/**< @brief glyph color */
+	unsigned long colors;	/**< @brief value of pixfmt_get_version() when the glyph was rasterized */
+	int advance;			/**< @brief value returned by the vg_draw_* function */
+	int extent;				/**< @brief width of the glyph's pixels, in screen pixels */
+	vg_runs_t image;		/**< @brief opaque runs of the glyph */
+	unsigned char *row;		/**< @brief one row of glyph colored pixels, shared by all runs */
+} GLYPH;
+/**@} end of Glyph */
+
+static GLYPH cache[FONT_CACHE_SETS][FONT_CACHE_WAYS];	/**< @brief Glyph cache */
+static unsigned long use_clock = 0;	/**< @brief Incremented on every lookup, for LRU eviction */
+static unsigned long versions = 0;	/**< @brief Incremented on every rasterized glyph, so a kept glyph can tell its entry was reused */
+static font_stats_t stats;			/**< @brief Cache counters */
+
+static unsigned int glyph_set(char symbol, unsigned char kind, unsigned int size, unsigned int color) {
+	unsigned int hash = (unsigned char)symbol;
+
+	hash = hash * 31 + kind;
+	hash = hash * 31 + size;
+	hash = hash * 31 + color;
+
+	return (hash ^ (hash >> 7)) % FONT_CACHE_SETS;
+}
+
+static void glyph_free(GLYPH *glyph) {
+	if(glyph->valid) {
+		free(glyph->image.runs);
+		free(glyph->row);
+		glyph->valid = 0;
+		stats.entries--;
+	}
+}
+
+static int pixel_is_set(const unsigned char *pixel, unsigned int bytes) {
+	while(bytes--) {
+		if(*pixel++) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Collect the runs of set pixels of the first height rows of a surface.
+ *
+ * @return number of runs, runs is only written to if it is not NULL
+ */
+static unsigned int collect_runs(const vg_surface_t *surface, unsigned int height, vg_run_t *runs, const unsigned char *row) {
+	unsigned int bytes = vg_get_bytes_per_pixel();
+	unsigned int x, y, start, count = 0;
+	const unsigned char *line;
+
+	for(y = 0; y < height; y++) {
+		line = surface->pixels + y * surface->pitch;
+		for(x = 0; x < surface->width; ) {
+			if(!pixel_is_set(line + x*bytes, bytes)) {
+				x++;
+				continue;
+			}
+			for(start = x; (x < surface->width) && pixel_is_set(line + x*bytes, bytes); x++);
+			if(runs != NULL) {
+				runs[count].x = start;
+				runs[count].y = y;
+				runs[count].len = x - start;
+				runs[count].pixels = row;
+			}
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * @brief Draw the glyph on an off-screen surface and collect its runs.
+ */
+static int glyph_rasterize(GLYPH *glyph) {
+	vg_surface_t *scratch, *previous;
+	vg_rect_t clip;
+	unsigned int x, width, height, bytes = vg_get_bytes_per_pixel();
+
+	if(glyph->kind == GLYPH_NUMBER) {
+		vg_number_extent(glyph->size, &width, &height);
+	}
+	else {
+		vg_char_extent(glyph->size, &width, &height);
+	}
+
+	/* the extra row holds a line in the glyph color, which becomes the runs' pixel data */
+	if((scratch = vg_surface_create(width, height + 1)) == NULL) {
+		return -1;
+	}
+
+	/* a glyph may be rasterized while drawing to a clipped screen or to another surface */
+	previous = vg_get_target();
+	vg_get_clip(&clip);
+	vg_set_target(scratch);
+	/* any non-zero color works as a mask */
+	if(glyph->kind == GLYPH_NUMBER) {
+		glyph->advance = vg_draw_number(0, 0, 1, glyph->symbol, glyph->size);
+	}
+	else {
+		glyph->advance = vg_draw_char(0, 0, 1, glyph->symbol, glyph->size);
+	}
+	vg_draw_line(0, height, width - 1, height, glyph->color);
+	vg_set_target(previous);
+	vg_set_clip(&clip);
+
+	if(glyph->advance == -1) {
+		vg_surface_destroy(scratch);
+		return -1;
+	}
+
+	/* the runs are in buffer pixels, the extents in screen pixels */
+	width = scratch->width;
+	height = scratch->height - 1;
+	glyph->image.width = width;
+	glyph->image.height = height;
+	glyph->image.count = collect_runs(scratch, height, NULL, NULL);
+	glyph->image.runs = malloc(sizeof(vg_run_t) * (glyph->image.count + 1));
+	glyph->row = malloc(width * bytes);
+
+	if((glyph->image.runs == NULL) || (glyph->row == NULL)) {
+		free(glyph->image.runs);
+		free(glyph->row);
+		vg_surface_destroy(scratch);
+		return -1;
+	}
+
+	memcpy(glyph->row, scratch->pixels + height * scratch->pitch, width * bytes);
+	collect_runs(scratch, height, glyph->image.runs, glyph->row);
+
+	glyph->extent = 0;
+	for(x = 0; x < glyph->image.count; x++) {
+		if(glyph->image.runs[x].x + glyph->image.runs[x].len > glyph->extent) {
+			glyph->extent = glyph->image.runs[x].x + glyph->image.runs[x].len;
+		}
+	}
+	glyph->extent *= vg_get_render_scale();
+
+	vg_surface_destroy(scratch);
+	return 0;
+}
+
+/**
+ * @brief Find a glyph in the cache, rasterizing it on a miss.
+ *
+ * @return the glyph, NULL if it could not be rasterized
+ */
+static GLYPH *glyph_lookup(char symbol, unsigned char kind, unsigned int size, unsigned int color) {
+	GLYPH *set = cache[glyph_set(symbol, kind, size, color)];
+	GLYPH *victim = &set[0];
+	unsigned int way;
+	int stale = 0;
+
+	use_clock++;
+
+	for(way = 0; way < FONT_CACHE_WAYS; way++) {
+		if(set[way].valid && (set[way].symbol == symbol) && (set[way].kind == kind) &&
+				(set[way].size == size) && (set[way].color == color)) {
+			if(set[way].colors == pixfmt_get_version()) {
+				set[way].last_use = use_clock;
+				stats.hits++;
+				return &set[way];
+			}
+			/* the pixels were converted through another palette: rasterized again, in the same entry */
+			victim = &set[way];
+			stale = 1;
+			break;
+		}
+		if(!set[way].valid) {
+			victim = &set[way];
+		}
+		else if(victim->valid && (set[way].last_use < victim->last_use)) {
+			victim = &set[way];
+		}
+	}
+
+	stats.misses++;
+	if(victim->valid) {
+		stats.evictions += !stale;
+		glyph_free(victim);
+	}
+
+	victim->symbol = symbol;
+	victim->kind = kind;
+	victim->size = size;
+	victim->color = color;
+	if(glyph_rasterize(victim) != 0) {
+		return NULL;
+	}
+	victim->valid = 1;
+	victim->colors = pixfmt_get_version();
+	victim->version = ++versions;
+	victim->last_use = use_clock;
+	stats.entries++;
+
+	return victim;
+}
+
+int font_draw_char(int x, int y, unsigned int color, char symbol, unsigned int size) {
+	GLYPH *glyph = glyph_lookup(symbol, GLYPH_CHAR, size, color);
+
+	if(glyph == NULL) {
+		return vg_draw_char(x, y, color, symbol, size);
+	}
+
+	if(vg_draw_runs(x, y, &glyph->image) == -1) {
+		return -1;
+	}
+	return glyph->advance;
+}
+
+int font_draw_number(int x, int y, unsigned int color, unsigned long digit, unsigned int size) {
+	GLYPH *glyph;
+
+	if(digit > 9) {
+		return -1;
+	}
+
+	if((glyph = glyph_lookup(digit, GLYPH_NUMBER, size, color)) == NULL) {
+		return vg_draw_number(x, y, color, digit, size);
+	}
+
+	if(vg_draw_runs(x, y, &glyph->image) == -1) {
+		return -1;
+	}
+	return glyph->advance;
+}
+
+void font_cache_warm(const unsigned int sizes[], unsigned int count, unsigned int color) {
+	static const char specials[] = "()'";
+	unsigned int i, j;
+	char symbol;
+
+	for(i = 0; i < count; i++) {
+		for(symbol = 'a'; symbol <= 'z'; symbol++) {
+			glyph_lookup(symbol, GLYPH_CHAR, sizes[i], color);
+		}
+		for(symbol = '0'; symbol <= '9'; symbol++) {
+			glyph_lookup(symbol, GLYPH_CHAR, sizes[i], color);
+			glyph_lookup(symbol - '0', GLYPH_NUMBER, sizes[i], color);
+		}
+		for(j = 0; specials[j] != '\0'; j++) {
+			glyph_lookup(specials[j], GLYPH_CHAR, sizes[i], color);
+		}
+	}
+}
+
+void font_cache_flush() {
+	unsigned int set, way;
+
+	for(set = 0; set < FONT_CACHE_SETS; set++) {
+		for(way = 0; way < FONT_CACHE_WAYS; way++) {
+			glyph_free(&cache[set][way]);
+		}
+	}
+}
+
+const font_stats_t *font_get_stats() {
+	return &stats;
+}
+
+/**
+ * @brief Run a vg_draw_* function with nothing visible, to get its return value.
+ */
+static int measure_uncached(char symbol, unsigned char kind, unsigned int size, unsigned int color) {
+	vg_rect_t clip, none = { 0, 0, 0, 0 };
+	int ret;
+
+	vg_get_clip(&clip);
+	vg_set_clip(&none);
+	if(kind == GLYPH_NUMBER) {
+		ret = vg_draw_number(0, 0, color, symbol, size);
+	}
+	else {
+		ret = vg_draw_char(0, 0, color, symbol, size);
+	}
+	vg_set_clip(&clip);
+
+	return ret;
+}
+
+/**
+ * @brief Fill a looked up glyph in, from its cache entry or, if it could not be cached, from its box.
+ */
+static void glyph_found(font_glyph_t *glyph, const GLYPH *entry, unsigned char kind, unsigned int size) {
+	unsigned int width, height;
+
+	glyph->entry = entry;
+	if(entry != NULL) {
+		glyph->version = entry->version;
+		glyph->extent = entry->extent;
+		return;
+	}
+
+	glyph->version = 0;
+	if(kind == GLYPH_NUMBER) {
+		vg_number_extent(size, &width, &height);
+	}
+	else {
+		vg_char_extent(size, &width, &height);
+	}
+	glyph->extent = width;
+}
+
+int font_lookup_char(unsigned int color, char symbol, unsigned int size, font_glyph_t *glyph) {
+	GLYPH *entry = glyph_lookup(symbol, GLYPH_CHAR, size, color);
+
+	glyph_found(glyph, entry, GLYPH_CHAR, size);
+
+	return (entry != NULL) ? entry->advance : measure_uncached(symbol, GLYPH_CHAR, size, color);
+}
+
+int font_lookup_number(unsigned int color, unsigned long digit, unsigned int size, font_glyph_t *glyph) {
+	GLYPH *entry;
+
+	if(digit > 9) {
+		glyph_found(glyph, NULL, GLYPH_NUMBER, size);
+		return -1;
+	}
+
+	entry = glyph_lookup(digit, GLYPH_NUMBER, size, color);
+
+	glyph_found(glyph, entry, GLYPH_NUMBER, size);
+
+	return (entry != NULL) ? entry->advance : measure_uncached(digit, GLYPH_NUMBER, size, color);
+}
+
+const vg_runs_t *font_glyph_runs(const font_glyph_t *glyph) {
+	const GLYPH *entry = glyph->entry;
+
+	/* the entry may have been evicted, given to another glyph or left with stale pixels since the lookup */
+	if((entry == NULL) || !entry->valid || (entry->version != glyph->version) || (entry->colors != pixfmt_get_version())) {
+		return NULL;
+	}
+
+	return &entry->image;
+}
+
+int font_measure_char(unsigned int color, char symbol, unsigned int size) {
+	font_glyph_t glyph;
+
+	return font_lookup_char(color, symbol, size, &glyph);
+}
+
+int font_measure_number(unsigned int color, unsigned long digit, unsigned int size) {
+	font_glyph_t glyph;
+
+	return font_lookup_number(color, digit, size, &glyph);
+}
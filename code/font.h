@@ -0,0 +1,136 @@
+#ifndef FONT_H_
+#define FONT_H_
+
+#include "libraries.h"
+#include "video_gr.h"
+
+/** @defgroup font font
+ * @{
+ *
+ * Cache of pre-rasterized glyphs of the segment font drawn by video_gr.
+ */
+
+#define FONT_CACHE_SETS		128	/**< @brief Number of sets of the glyph cache */
+#define FONT_CACHE_WAYS		4	/**< @brief Glyphs per set; the least recently used one is evicted */
+
+/** @name Font Stats */
+/**@{
+ *
+ * Glyph cache counters
+ */
+typedef struct {
+	unsigned long hits;			/**< @brief glyphs found in the cache */
+	unsigned long misses;		/**< @brief glyphs rasterized */
+	unsigned long evictions;	/**< @brief glyphs dropped to make room for others */
+	unsigned int entries;		/**< @brief glyphs currently cached */
+} font_stats_t;
+/** @} end of Font Stats */
+
+/** @name Font Glyph */
+/**@{
+ *
+ * Glyph looked up in the cache, kept to draw it later without looking it up again
+ */
+typedef struct {
+	const void *entry;		/**< @brief cache entry of the glyph, NULL if it could not be cached */
+	unsigned long version;	/**< @brief version of the entry when it was looked up */
+	int extent;				/**< @brief width of the glyph's pixels from its x, in screen pixels */
+} font_glyph_t;
+/** @} end of Font Glyph */
+
+/**
+ * @brief Draw a char in the video buffer through the glyph cache. Same as vg_draw_char().
+ *
+ * @param x char's x coordinate (left)
+ * @param y char's y coordinate (top)
+ * @param color color of the char
+ * @param symbol char to be written
+ * @param size size of the char
+ *
+ * @return horizontal advance returned by vg_draw_char(), -1 on error
+ */
+int font_draw_char(int x, int y, unsigned int color, char symbol, unsigned int size);
+/**
+ * @brief Draw a digit in the video buffer through the glyph cache. Same as vg_draw_number().
+ *
+ * @param x digit's x coordinate (left)
+ * @param y digit's y coordinate (top)
+ * @param color color of the digit
+ * @param digit digit to be written (0 to 9)
+ * @param size size of the digit
+ *
+ * @return value returned by vg_draw_number(), -1 on error
+ */
+int font_draw_number(int x, int y, unsigned int color, unsigned long digit, unsigned int size);
+/**
+ * @brief Get what font_draw_char() would return, without drawing.
+ *
+ * @param color color of the char
+ * @param symbol char to measure
+ * @param size size of the char
+ *
+ * @return horizontal advance returned by vg_draw_char(), -1 on error
+ */
+int font_measure_char(unsigned int color, char symbol, unsigned int size);
+/**
+ * @brief Get what font_draw_number() would return, without drawing.
+ *
+ * @param color color of the digit
+ * @param digit digit to measure (0 to 9)
+ * @param size size of the digit
+ *
+ * @return value returned by vg_draw_number(), -1 on error
+ */
+int font_measure_number(unsigned int color, unsigned long digit, unsigned int size);
+/**
+ * @brief Look a char up in the glyph cache, rasterizing it if needed, to draw it later.
+ *
+ * @param color color of the char
+ * @param symbol char to look up
+ * @param size size of the char
+ * @param glyph where to store the cache entry, for font_glyph_runs()
+ *
+ * @return horizontal advance returned by vg_draw_char(), -1 on error
+ */
+int font_lookup_char(unsigned int color, char symbol, unsigned int size, font_glyph_t *glyph);
+/**
+ * @brief Look a digit up in the glyph cache, rasterizing it if needed, to draw it later.
+ *
+ * @param color color of the digit
+ * @param digit digit to look up (0 to 9)
+ * @param size size of the digit
+ * @param glyph where to store the cache entry, for font_glyph_runs()
+ *
+ * @return value returned by vg_draw_number(), -1 on error
+ */
+int font_lookup_number(unsigned int color, unsigned long digit, unsigned int size, font_glyph_t *glyph);
+/**
+ * @brief Get the runs of a glyph looked up before.
+ *
+ * @param glyph glyph returned by font_lookup_char() or font_lookup_number()
+ *
+ * @return runs of the glyph, NULL if it was not cached or its entry was reused since
+ */
+const vg_runs_t *font_glyph_runs(const font_glyph_t *glyph);
+/**
+ * @brief Rasterize every char and digit of the given sizes in one color.
+ *
+ * @param sizes array of char sizes
+ * @param count number of elements in sizes
+ * @param color glyph color
+ */
+void font_cache_warm(const unsigned int sizes[], unsigned int count, unsigned int color);
+/**
+ * @brief Drop every cached glyph.
+ */
+void font_cache_flush();
+/**
+ * @brief Get the glyph cache counters.
+ *
+ * @return pointer to the counters
+ */
+const font_stats_t *font_get_stats();
+
+/** @} end of font */
+
+#endif /* FONT_H_ */
@@ -5,6 +5,12 @@
 #include "keyboard.h"
 #include "vbe.h"
 #include "video_gr.h"
+#include "font.h"
+#include "sprite.h"
+#include "dlist.h"
+#include "text.h"
+#include "palette.h"
+#include "memops.h"
 #include "timer.h"
 #include "i8042.h"
 #include "i8254.h"
@@ -17,8 +23,8 @@ const unsigned int MOUSE_IRQ_SET = 4;	/**< @brief Mouse ID */
 const int HMAX = 1024;	/**< @brief Horizontal resolution. */
 const int VMAX = 768;	/**< @brief Vertical resolution. */
 
-const char str_end = '.';	/**< @brief Char used for "end of string". */
-const char str_newline = ':';	/**< @brief Char used for "new line".*/
+const char str_end = TEXT_END;	/**< @brief Char used for "end of string". */
+const char str_newline = TEXT_NEWLINE;	/**< @brief Char used for "new line".*/
 
 unsigned short int debug = 0;	/**< @brief Variable containing the information about debugmode (0 = OFF ; 1 = ON). */
 unsigned int lvl = 1;			/**< @brief Game level. */
@@ -26,6 +32,7 @@ unsigned int difficulty = 1;	/**< @brief Game difficulty. */
 unsigned int next_level_score;	/**< @brief Score for the next level. */
 
 unsigned int player_colors[] = { 0, 32, 17};		/**< @brief Colors of the player sprite. */
+unsigned int cursor_colors[] = { 0, 55};		/**< @brief Colors of the cursor sprite. */
 unsigned int colors[] = { 63, 36, 18, 27, 54, 38, 53};		/**< @brief General colors of the game. */
 unsigned int colors_faded[] = { 0, 4, 2, 57, 55, 20, 21};		/**< @brief General faded colors of the game. */
 unsigned int colors_takeaway[] = { 100, 90, 20, 70, 50, 40, 30};	/**< @brief Amount of power to take from the player - related to each color of colors[]. */
@@ -37,15 +44,37 @@ unsigned int black_holes = 0;	/**< @brief Number of holes containing the black c
 unsigned int divisions = 8;		/**< @brief Number of board divisions. */
 int hole_color[8];	/**< @brief Array containing the color of the 8 board divisions. */
 
+vg_surface_t *board = NULL;	/**< @brief Board layer, holds the rings already swept by the red square. */
+unsigned int board_rings = 0;	/**< @brief Rings drawn on the board layer (1 to board_rings). */
+int board_colors[8];	/**< @brief Division colors the board layer was drawn with. */
+unsigned long board_version = 0;	/**< @brief Incremented whenever the board layer is drawn to. */
+
+SPRITE *player_image = NULL;	/**< @brief Compiled player sprite. */
+SPRITE *cursor_image = NULL;	/**< @brief Compiled cursor sprite. */
+SPRITE_OVERLAY cursor_overlay;	/**< @brief Cursor drawn over the menu screens. */
+
+int menu_screen = -1;	/**< @brief Menu option drawn in the buffer, -1 if the buffer holds something else. */
+int overdraw_screen = -1;	/**< @brief Option whose overdraw was last printed, -1 if none. */
+unsigned long menu_layout = 0;	/**< @brief Incremented whenever the menu layers must be drawn again. */
+long menu_date = -1;	/**< @brief Date shown by the drawn menu screen, as returned by getMenuDate(). */
+
 unsigned int red_square_size = 4;	/**< @brief Size of the moving red square. */
 unsigned int red_square_index = 1;	/**< @brief Current index of the red quare. */
 unsigned int red_square_color = 4;	/**< @brief Color of the red square. */
 unsigned int red_square_speed = 2;	/**< @brief Speed of the red square. */
 
 short int first_round = 1;	/**< @brief Variable containing the information on whether it is or not the first round. */
+unsigned long logic_ticks = 0;	/**< @brief Game logic steps done by gameLogicTick(). */
+FILE *input_record = NULL;	/**< @brief File the keys pressed while playing are recorded to, NULL if not recording. */
+short int clock_fixed = 0;	/**< @brief game_rtc is set by goldenClock() instead of being read from the RTC. */
 const int reasonable_iterations = 100;
 
+const unsigned int text_sizes[] = { CHAR_SIZE, 6, 10 };	/**< @brief Char sizes used by the game, for the glyph cache. */
+
 unsigned int option = 0;	/**< @brief Current menu option. This options are enumerated in the "core options indexes" enum. */
+int end_reason = 0;	/**< @brief Why the end screen is shown: -1 if the player has lost, -2 if the player has quit. */
+unsigned int end_phase = 0;	/**< @brief Phase of the end screen transition. This phases are enumerated in the "end screen phases" enum. */
+unsigned int end_ticks = 0;	/**< @brief Timer ticks the end screen has been shown for, once faded in. */
 unsigned int back_color = 57;	/**< @brief Background color for the menus. */
 
 /* player direction */
@@ -89,10 +118,23 @@ enum {
 	MENU_HELP,
 	MENU_OPTIONS,
 	MENU_CREDITS,
-	GAME
+	GAME,
+	END
 };
 /** @} end of options indexes */
 
+/** @name  end screen phases */
+/**@{
+ *
+ * Simbolic names for the phases of the end screen transition
+ */
+enum {
+	END_FADE_OUT,
+	END_FADE_IN,
+	END_HOLD
+};
+/** @} end of end screen phases */
+
 /** @name  titles indexes */
 /**@{
  *
@@ -134,12 +176,13 @@ struct {
 	unsigned int size;	/**< @brief Cursor size*/
 }cursor
 /* cursor sprite */
+/* the numbers are indexes to the color in the array cursor_colors[] */
 = {
-		{		{"7777 "},
-				{"77   "},
-				{"7 7  "},
-				{"7  7 "},
-				{"    7"}}
+		{		{"1111 "},
+				{"11   "},
+				{"1 1  "},
+				{"1  1 "},
+				{"    1"}}
 };
 /** @} end of cursor struct */
 
@@ -283,6 +326,18 @@ struct {
 };
 /** @} end of player struct */
 
+/** @name  menu layers struct */
+/**@{
+ *
+ * Contains the static layer of a menu screen
+ */
+typedef struct {
+	vg_surface_t *surface;	/**< @brief Background, frame and text of the screen, NULL until drawn */
+	unsigned long layout;	/**< @brief Value of menu_layout it was drawn with */
+	unsigned long colors;	/**< @brief Value of pixfmt_get_version() it was drawn with */
+}MENU_LAYERS;
+/** @} end of menu layers struct */
+
 /* struct instances definition */
 TIMERS timer;
 KEYBOARDS keyboard;
@@ -291,11 +346,12 @@ SCENARIOS scenario[SCENARIOS_NUM];
 TITLES titles[10];
 BARS bars[10];
 DATES startDate, endDate;
+MENU_LAYERS menu_layers[MENU_CREDITS + 1];
 RTC game_rtc;
 
 //********************************************* SCREEN *******************************
 int debugTestWrite(int x, int y, int number) {
-	vg_fill_section(x,y,x + 120, y + 40,0);
+	dl_fill(x,y,x + 120, y + 40,0);
 	if(drawNumber(x,y,number,4,0) == -1) {
 		return -1;
 	}
@@ -303,39 +359,18 @@ int debugTestWrite(int x, int y, int number) {
 }
 
 int drawString(int x, int y, char * str, int size, unsigned int color) {
-
-	unsigned int index = 0;
-	int xi = x;
-	int returnValue;
-	char toCompare;
-	toCompare = str[index];
+	const TEXT_LAYOUT *layout;
 
 	if(!size) {
 		size = CHAR_SIZE;
 	}
 
-	while(toCompare != str_end) {
-
-		if(toCompare != str_newline) {
-			returnValue = vg_draw_char(x, y, (color != 0) ? color : CHAR_COLOR, toCompare, size);
-			if(returnValue == -1) {
-				return -1;
-			}
-			else {
-				x += returnValue;
-			}
-			x += 2*size;
-		}
-		else {
-			y += size*6;
-			x = xi;
-		}
-
-		index++;
-		toCompare = str[index];
-
+	layout = text_get(str, size, (color != 0) ? color : CHAR_COLOR, 0);
+	if((layout == NULL) || (text_draw(layout, x, y) == -1)) {
+		return -1;
 	}
-	return (x - xi);
+
+	return layout->advance;
 }
 
 int drawNumber(int x, int y, long int number, unsigned int color, int size) {
@@ -356,10 +391,10 @@ int drawNumber(int x, int y, long int number, unsigned int color, int size) {
 
 	// draw the " - "
 	if(number < 0) {
-		if(vg_draw_line(x,y+(3*size/4),x+size,y+(size/2),color) == -1) {
+		if(dl_line(x,y+(3*size/4),x+size,y+(size/2),color) == -1) {
 			return -1;
 		}
-		if(vg_draw_line(x,y+(3*size/4) + 1,x+size,y+(size/2) + 1,color) == -1) {
+		if(dl_line(x,y+(3*size/4) + 1,x+size,y+(size/2) + 1,color) == -1) {
 			return -1;
 		}
 		number = -number;
@@ -368,7 +403,7 @@ int drawNumber(int x, int y, long int number, unsigned int color, int size) {
 	x += (size + (3*size/2)) * length + size;
 
 	do {
-		if(vg_draw_number(x, y, color, (number % 10), size) == -1) {
+		if(dl_number(x, y, color, (number % 10), size) == -1) {
 			return -1;
 		}
 		x -= 2*size;
@@ -379,11 +414,12 @@ int drawNumber(int x, int y, long int number, unsigned int color, int size) {
 }
 
 int clearScreen(unsigned int x, unsigned int y, unsigned int xf, unsigned int yf, unsigned int color) {
-	vg_fill(color);
+	dl_fill(0, 0, HMAX, VMAX, color);
 	return 0;
 }
 
 int drawError(char * str) {
+	dl_abort();
 	clearBuffer(0);
 	if(drawString(MENU_X,MENU_Y,str,0,0) ==	-1) {
 		return -1;
@@ -392,6 +428,17 @@ int drawError(char * str) {
 	return 0;
 }
 
+void printOverdraw() {
+	static const char * names[] = { "menu", "help", "options", "credits", "game" };
+	const vg_overdraw_stats_t * stats = vg_get_overdraw_stats();
+	unsigned long mean = (stats->pixels > 0) ? stats->writes * 100 / stats->pixels : 0;
+	unsigned long mean_covered = (stats->covered > 0) ? stats->writes * 100 / stats->covered : 0;
+
+	printf("overdraw %s: max %u, mean %lu.%02lu per pixel, %lu.%02lu per pixel written\n",
+			(option <= GAME) ? names[option] : "?", stats->max, mean / 100, mean % 100, mean_covered / 100, mean_covered % 100);
+	overdraw_screen = option;
+}
+
 //********************************************* DATE/TIME ****************************
 void getStartTime() {
 	startDate.hours = rtc_get_hours(game_rtc);
@@ -716,32 +763,7 @@ int updatePlayerScore() {
 }
 
 int drawPlayer() {
-	int i, j, indexLine = 0, indexCol = 0;
-	unsigned int color;
-
-	for(i = 0; i < player.height; i += 1) {
-		for(j = 0; j < player.width; j += 1) {
-			if(player.sprite[i][j] != ' ') {
-				color = player_colors[(unsigned int)(player.sprite[i][j]) - 48];
-				if(vg_set_pixel(player.x + indexCol, player.y + indexLine, color) == -1) {
-					return -1;
-				}
-				if(vg_set_pixel(player.x + indexCol + 1, player.y + indexLine, color) == -1) {
-					return -1;
-				}
-				if(vg_set_pixel(player.x + indexCol + 1, player.y + indexLine + 1, color) == -1) {
-					return -1;
-				}
-				if(vg_set_pixel(player.x + indexCol, player.y + indexLine + 1, color) == -1) {
-					return -1;
-				}
-			}
-			indexCol += PLAYER_PIX_SIZE;
-		}
-		indexCol = 0;
-		indexLine += PLAYER_PIX_SIZE;
-	}
-	return 0;
+	return dl_runs(player.x, player.y, &player_image->image);
 }
 
 //********************************************* SCENARIO *****************************
@@ -849,61 +871,152 @@ int updateScenario() {
 	return 0;
 }
 
+int drawBoard(unsigned int inner, unsigned int outer, int origin_x, int origin_y) {
+	/* division drawing order of vg_draw_death_square, so the shared edges get the same color */
+	static const unsigned int order[8] = { 0, 1, 5, 4, 7, 6, 2, 3 };
+	vg_point_t octant[8][4];
+	int ox1, oy1, ox2, oy2, ix1, iy1, ix2, iy2, mx, my;
+	unsigned int iter;
+
+	if((inner > outer) || (outer >= SCENARIOS_NUM)) {
+		return -1;
+	}
+
+	ox1 = scenario[outer].x - origin_x;
+	oy1 = scenario[outer].y - origin_y;
+	ox2 = ox1 + scenario[outer].size;
+	oy2 = oy1 + scenario[outer].size;
+	ix1 = scenario[inner].x - origin_x;
+	iy1 = scenario[inner].y - origin_y;
+	ix2 = ix1 + scenario[inner].size;
+	iy2 = iy1 + scenario[inner].size;
+	mx = SCENARIO_X_MIDDLE - origin_x;
+	my = SCENARIO_Y_MIDDLE - origin_y;
+
+	/* top, left to right */
+	octant[0][0].x = ox1; octant[0][0].y = oy1; octant[0][1].x = mx;  octant[0][1].y = oy1;
+	octant[0][2].x = mx;  octant[0][2].y = iy1; octant[0][3].x = ix1; octant[0][3].y = iy1;
+	octant[1][0].x = mx;  octant[1][0].y = oy1; octant[1][1].x = ox2; octant[1][1].y = oy1;
+	octant[1][2].x = ix2; octant[1][2].y = iy1; octant[1][3].x = mx;  octant[1][3].y = iy1;
+	/* right, top to bottom */
+	octant[2][0].x = ix2; octant[2][0].y = iy1; octant[2][1].x = ox2; octant[2][1].y = oy1;
+	octant[2][2].x = ox2; octant[2][2].y = my;  octant[2][3].x = ix2; octant[2][3].y = my;
+	octant[3][0].x = ix2; octant[3][0].y = my;  octant[3][1].x = ox2; octant[3][1].y = my;
+	octant[3][2].x = ox2; octant[3][2].y = oy2; octant[3][3].x = ix2; octant[3][3].y = iy2;
+	/* bottom, right to left */
+	octant[4][0].x = mx;  octant[4][0].y = iy2; octant[4][1].x = ix2; octant[4][1].y = iy2;
+	octant[4][2].x = ox2; octant[4][2].y = oy2; octant[4][3].x = mx;  octant[4][3].y = oy2;
+	octant[5][0].x = ix1; octant[5][0].y = iy2; octant[5][1].x = mx;  octant[5][1].y = iy2;
+	octant[5][2].x = mx;  octant[5][2].y = oy2; octant[5][3].x = ox1; octant[5][3].y = oy2;
+	/* left, bottom to top */
+	octant[6][0].x = ox1; octant[6][0].y = my;  octant[6][1].x = ix1; octant[6][1].y = my;
+	octant[6][2].x = ix1; octant[6][2].y = iy2; octant[6][3].x = ox1; octant[6][3].y = oy2;
+	octant[7][0].x = ox1; octant[7][0].y = oy1; octant[7][1].x = ix1; octant[7][1].y = iy1;
+	octant[7][2].x = ix1; octant[7][2].y = my;  octant[7][3].x = ox1; octant[7][3].y = my;
+
+	for(iter = 0; iter < 8; iter++) {
+		if(vg_fill_polygon(octant[order[iter]], 4, hole_color[order[iter]]) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int updateBoard() {
+	int clear = 0;
+
+	if(board == NULL) {
+		if((board = vg_surface_create(SCENARIO_SIZE + 1, SCENARIO_SIZE + 1)) == NULL) {
+			return -1;
+		}
+		clear = 1;
+	}
+
+	vg_set_target(board);
+
+	if(clear || (memcmp(board_colors, hole_color, sizeof(hole_color)) != 0) || ((red_square_index - 1) < board_rings)) {
+		vg_fill(0);
+		/* the layer is opaque: the frame square goes under the rings here, as it does on the screen */
+		if(vg_draw_square(scenario[SCENARIOS_NUM - 1].x - SCENARIO_X, scenario[SCENARIOS_NUM - 1].y - SCENARIO_Y,
+				scenario[SCENARIOS_NUM - 1].size, red_square_color) == -1) {
+			vg_set_target(NULL);
+			return -1;
+		}
+		board_version++;
+		board_rings = 0;
+		memcpy(board_colors, hole_color, sizeof(hole_color));
+	}
+
+	if((board_rings + 1) < red_square_index) {
+		if(drawBoard(board_rings + 1, red_square_index - 1, SCENARIO_X, SCENARIO_Y) == -1) {
+			vg_set_target(NULL);
+			return -1;
+		}
+		board_version++;
+	}
+	board_rings = red_square_index - 1;
+
+	vg_set_target(NULL);
+	return 0;
+}
+
 int drawScenario() {
-	unsigned int index;
 	unsigned int inner_index;
 
-	if(vg_draw_square(scenario[SCENARIOS_NUM - 1].x,scenario[SCENARIOS_NUM - 1].y,scenario[SCENARIOS_NUM - 1].size,red_square_color) == -1) {
+	/* without debug, the board layer holds the frame square and covers it */
+	if(debug && (dl_square(scenario[SCENARIOS_NUM - 1].x,scenario[SCENARIOS_NUM - 1].y,scenario[SCENARIOS_NUM - 1].size,red_square_color) == -1)) {
 		drawError("error in first drawsquare.");
 		sleep(2);
 		return -1;
 	}
 
 	if(!debug) {
-		for(index = 1; index <= red_square_index; index++) {
-			if(index < red_square_index) {
-				if(vg_draw_death_square(scenario[index].x,scenario[index].y,scenario[index].size,hole_color) == -1) {
-					drawError("error in drawdeathsquare.");
-					sleep(2);
-					return -1;
-				}
-			}
-			else if(index == red_square_index) {
-				for(inner_index = 0 ; (inner_index < red_square_size) && ((index + inner_index) < SCENARIOS_NUM); inner_index++ ) {
-					if(vg_draw_square(scenario[index + inner_index].x,
-							scenario[index + inner_index].y,
-							scenario[index + inner_index].size,
-							red_square_color) == -1) {
-						drawError("error in drawredsquare.");
-						sleep(2);
-						return -1;
-					}
-				}
-//				index += red_square_size;
+		if(updateBoard() == -1) {
+			drawError("error in updateboard.");
+			sleep(2);
+			return -1;
+		}
+		dl_blit(board, SCENARIO_X, SCENARIO_Y, board_version);
+
+		for(inner_index = 0 ; (inner_index < red_square_size) && ((red_square_index + inner_index) < SCENARIOS_NUM); inner_index++ ) {
+			if(dl_square(scenario[red_square_index + inner_index].x,
+					scenario[red_square_index + inner_index].y,
+					scenario[red_square_index + inner_index].size,
+					red_square_color) == -1) {
+				drawError("error in drawredsquare.");
+				sleep(2);
+				return -1;
 			}
 		}
 	}
+
 	return 0;
 }
 
 int drawSideMenu() {
 	unsigned int index = 0;
+	vg_fill_t fills[SAFE_COLOR + 1];
 	if(!debug) {
 		for(index = LIVES; index <= SAFE_COLOR; index++) {
 			if(drawString(bars[index].x, bars[index].y, bars[index].title,0,0) == -1) {
 				return -1;
 			}
-			if(vg_fill_section(bars[index].x, bars[index].y + BAR_HSPACE,
-					bars[index].x + bars[index].hSize, bars[index].y + BAR_HEIGHT + bars[index].vSize,
-					bars[index].color) == -1) {
-				return -1;
-			}
-			if(vg_draw_rectangle(bars[index].x-1, bars[index].y-1 + BAR_HSPACE,
+			fills[index].rect.x1 = bars[index].x;
+			fills[index].rect.y1 = bars[index].y + BAR_HSPACE;
+			fills[index].rect.x2 = bars[index].x + bars[index].hSize;
+			fills[index].rect.y2 = bars[index].y + BAR_HEIGHT + bars[index].vSize;
+			fills[index].color = bars[index].color;
+			if(dl_rectangle(bars[index].x-1, bars[index].y-1 + BAR_HSPACE,
 					bars[index].x + BAR_LENGTH, bars[index].y + BAR_HEIGHT + bars[index].vSize,
 					colors[WHITE]) == -1) {
 				return -1;
 			}
 		}
+		/* bars don't overlap their titles nor frames, all of them are filled at once */
+		if(dl_fills(fills, SAFE_COLOR + 1) == -1) {
+			return -1;
+		}
 		if(drawString(bars[SCORE].x, bars[SCORE].y, bars[SCORE].title,0,0) == -1) {
 			return -1;
 		}
@@ -932,7 +1045,9 @@ int drawBufferToScreen() {
 }
 
 int clearBuffer(unsigned int color) {
-	vg_fill(color);
+	dl_fill(0, 0, HMAX, VMAX, color);
+	menu_screen = -1;
+	sprite_overlay_drop(&cursor_overlay);
 	return 0;
 }
 
@@ -961,34 +1076,14 @@ int isMouseInsideTitle() {
 }
 
 int drawCursor() {
-	int i, j, indexLine = 0, indexCol = 0;
-	int cursMult = CURSOR_MULT/2;
-	int index1, index2;
-
-	for(i = 0; i < cursor.width; i++) {
-		for(j = 0; j < cursor.width; j++) {
-			if(cursor.sprite[i][j] != ' ') {
-				for(index1 = 0; index1 < cursMult; index1++) {
-					for(index2 = 0; index2 < cursMult; index2++) {
-						if(vg_set_pixel(mouse.x + indexCol + index2, mouse.y + indexLine + index1, (cursor.sprite[i][j])) == -1) {
-							return -1;
-						}
-					}
-				}
-			}
-			indexCol += CURSOR_PIX_SIZE;
-		}
-		indexCol = 0;
-		indexLine += CURSOR_PIX_SIZE;
-	}
-	return 0;
+	return dl_runs(mouse.x, mouse.y, &cursor_image->image);
 }
 
 //********************************************* MENU *********************************
 int drawFrame() {
 	int index;
 	for(index = 1; index <= 4; index += 1) {
-		if(vg_draw_rectangle(index, index, (HMAX - index), (VMAX - index), CHAR_COLOR) == -1) {
+		if(dl_rectangle(index, index, (HMAX - index), (VMAX - index), CHAR_COLOR) == -1) {
 			return -1;
 		}
 	}
@@ -999,10 +1094,6 @@ int drawMenu() {
 	unsigned int index = 0;
 	int x,y;
 
-	if(drawMenuDate() == -1) {
-		return -1;
-	}
-
 	for(index = 0; index <= QUIT; index++) {
 		if(titles[index].visible) {
 			x = titles[index].x;
@@ -1016,11 +1107,118 @@ int drawMenu() {
 	return 0;
 }
 
+long getMenuDate() {
+	return ((rtc_get_month_day(game_rtc)*24L + rtc_get_hours(game_rtc))*60 + rtc_get_minutes(game_rtc))*60 + rtc_get_seconds(game_rtc);
+}
+
+vg_surface_t *getMenuLayer(unsigned int screen) {
+	MENU_LAYERS *layer = &menu_layers[screen];
+	int returnValue = 0;
+
+	if((layer->surface != NULL) && (layer->layout == menu_layout) && (layer->colors == pixfmt_get_version())) {
+		return layer->surface;
+	}
+
+	vg_surface_destroy(layer->surface);
+	if((layer->surface = vg_surface_create(HMAX, VMAX)) == NULL) {
+		return NULL;
+	}
+
+	vg_set_target(layer->surface);
+	vg_fill(back_color);
+	returnValue = drawFrame();
+	if(returnValue != -1) {
+		switch(screen) {
+		case MENU:
+			returnValue = drawMenu();
+			break;
+		case MENU_HELP:
+			returnValue = drawMenuHelp();
+			break;
+		case MENU_OPTIONS:
+			returnValue = drawMenuOptions();
+			break;
+		case MENU_CREDITS:
+			returnValue = drawMenuCredits();
+			break;
+		default:
+			break;
+		}
+	}
+	vg_set_target(NULL);
+
+	if(returnValue == -1) {
+		vg_surface_destroy(layer->surface);
+		layer->surface = NULL;
+		return NULL;
+	}
+
+	layer->layout = menu_layout;
+	layer->colors = pixfmt_get_version();
+	/* the buffer may be showing the old layer */
+	menu_screen = -1;
+
+	return layer->surface;
+}
+
+void invalidateMenuLayers() {
+	menu_layout++;
+}
+
+int drawMenuScreen() {
+	long date = (option == MENU) ? getMenuDate() : -1;
+	vg_surface_t *layer;
+	unsigned int width, height;
+	vg_rect_t date_box;
+
+	if((layer = getMenuLayer(option)) == NULL) {
+		return -1;
+	}
+
+	if(menu_screen != (int)option) {
+		sprite_overlay_drop(&cursor_overlay);
+		dl_invalidate();
+		if(vg_blit_surface(layer, 0, 0) == -1) {
+			return -1;
+		}
+		menu_screen = option;
+		menu_date = -1;
+	}
+
+	if(menu_date != date) {
+		/* the date's part of the layer, as high as its digits (size 10) or its month (size 6) */
+		vg_number_extent(10, &width, &height);
+		date_box.x1 = DATE_X;
+		date_box.y1 = DATE_Y;
+		date_box.x2 = HMAX;
+		date_box.y2 = DATE_Y + height;
+		vg_char_extent(6, &width, &height);
+		if(date_box.y2 < DATE_Y + (int)height) {
+			date_box.y2 = DATE_Y + height;
+		}
+
+		sprite_overlay_hide(&cursor_overlay);
+		vg_set_clip(&date_box);
+		vg_blit_surface(layer, 0, 0);
+		vg_set_clip(NULL);
+		if(drawMenuDate() == -1) {
+			return -1;
+		}
+		menu_date = date;
+	}
+	else if(cursor_overlay.visible && (cursor_overlay.x == mouse.x) && (cursor_overlay.y == mouse.y)) {
+		return 0;
+	}
+
+	return sprite_overlay_show(&cursor_overlay, mouse.x, mouse.y);
+}
+
 int drawMenuDate() {
-	int x = (0.70 * HMAX);
-	int y = (0.10 * VMAX);
+	int x = DATE_X;
+	int y = DATE_Y;
 
 	int returnValue;
+	char *month;
 
 	int month_day = rtc_get_month_day(game_rtc);
 	int hours = rtc_get_hours(game_rtc);
@@ -1028,7 +1226,7 @@ int drawMenuDate() {
 	int sec = rtc_get_seconds(game_rtc);
 
 	if (month_day < 10) {
-		returnValue = drawNumber(x,y,0,7,10);
+		returnValue = drawNumber(x,y,0,DATE_COLOR,10);
 		if(returnValue == -1) {
 			return -1;
 		}
@@ -1037,7 +1235,7 @@ int drawMenuDate() {
 		}
 		x += 10;
 	}
-	returnValue = drawNumber(x,y,month_day,7,10);
+	returnValue = drawNumber(x,y,month_day,DATE_COLOR,10);
 	if(returnValue == -1) {
 		return -1;
 	}
@@ -1046,7 +1244,9 @@ int drawMenuDate() {
 	}
 	x += 20;
 
-	returnValue = drawString(x,y,rtc_get_month(game_rtc),6,7);
+	month = rtc_get_month(game_rtc);
+	returnValue = drawString(x,y,month,6,DATE_COLOR);
+	free(month);
 	if(returnValue == -1) {
 		return -1;
 	}
@@ -1055,7 +1255,7 @@ int drawMenuDate() {
 	}
 
 	if (hours < 10) {
-		returnValue = drawNumber(x,y,0,7,10);
+		returnValue = drawNumber(x,y,0,DATE_COLOR,10);
 		if(returnValue == -1) {
 			return -1;
 		}
@@ -1063,7 +1263,7 @@ int drawMenuDate() {
 			x += returnValue;
 		}
 	}
-	returnValue = drawNumber(x,y,hours,7,10);
+	returnValue = drawNumber(x,y,hours,DATE_COLOR,10);
 	if(returnValue == -1) {
 		return -1;
 	}
@@ -1073,7 +1273,7 @@ int drawMenuDate() {
 	x += 14;
 
 	if (min < 10) {
-		returnValue = drawNumber(x,y,0,7,10);
+		returnValue = drawNumber(x,y,0,DATE_COLOR,10);
 		if(returnValue == -1) {
 			return -1;
 		}
@@ -1082,7 +1282,7 @@ int drawMenuDate() {
 		}
 		x += 10;
 	}
-	returnValue = drawNumber(x,y,min,7,10);
+	returnValue = drawNumber(x,y,min,DATE_COLOR,10);
 	if(returnValue == -1) {
 		return -1;
 	}
@@ -1092,7 +1292,7 @@ int drawMenuDate() {
 	x += 14;
 
 	if (sec < 10) {
-		returnValue = drawNumber(x,y,0,7,10);
+		returnValue = drawNumber(x,y,0,DATE_COLOR,10);
 		if(returnValue == -1) {
 			return -1;
 		}
@@ -1101,7 +1301,7 @@ int drawMenuDate() {
 		}
 		x += 10;
 	}
-	returnValue = drawNumber(x,y,sec,7,10);
+	returnValue = drawNumber(x,y,sec,DATE_COLOR,10);
 	if(returnValue == -1) {
 		return -1;
 	}
@@ -1113,7 +1313,7 @@ int drawMenuDate() {
 }
 
 int drawMenuHelp() {
-	return drawString(HELP_X,HELP_Y, "the game consists in escaping the bad colors::"
+	const TEXT_LAYOUT *layout = text_get("the game consists in escaping the bad colors::"
 							 	 "each round a safe color is chosen::"
 							 	 "if the player's figure is not on that color:"
 							 	 "upon the round's ending the player loses:"
@@ -1121,7 +1321,12 @@ int drawMenuHelp() {
 							 	 "the tile the player is in::"
 							 	 "(a round is the time that the red square:"
 							 	 "takes to fill the game board)::use 'a' 'w' 's' 'd' to control the figure::"
-							 	 "exit   (esc).",0,0);
+							 	 "exit   (esc).", CHAR_SIZE, CHAR_COLOR, HMAX - 2*HELP_X);
+
+	if(layout == NULL) {
+		return -1;
+	}
+	return text_draw(layout, HELP_X, HELP_Y);
 }
 
 int drawMenuOptions() {
@@ -1137,104 +1342,156 @@ int drawMenuCredits() {
 								   "  if you are enlightened press esc:  to return to menu.",0,0);
 }
 
-int drawLoserScreen() {
-	int x = LOSER_X;
-	int y = LOSER_Y;
-	clearBuffer(back_color);
-	if(drawString(x,y,"you kinda lost.",0,0) == -1) {
-		return -1;
-	}
-	y += 8*CHAR_SIZE;
-	x += drawString(x,y,"score.",0,0);
-	x += 2*CHAR_SPACE;
-	y += 11;
-	if(drawNumber(x,y,player.score,colors[GREEN],0) == -1) {
+int drawLabeledNumber(int x, int y, char * label, long int number) {
+	const TEXT_LAYOUT *layout = text_get(label, CHAR_SIZE, CHAR_COLOR, 0);
+
+	if((layout == NULL) || (text_draw(layout, x, y) == -1)) {
 		return -1;
 	}
-	x = LOSER_X;
-	y += 8*CHAR_SIZE;
-	x += drawString(x,y,"time played (sec).",0,0);
-	x += 2*CHAR_SPACE;
-	y += 11;
-	if(drawNumber(x,y,getPlayTime(),colors[GREEN],0) == -1) {
+	if(drawNumber(x + layout->advance + 2*CHAR_SPACE, y + 11, number, colors[GREEN], 0) == -1) {
 		return -1;
 	}
-	drawBufferToScreen();
 	return 0;
 }
 
-int drawQuitScreen() {
-	int x = LOSER_X;
+int drawEndScreen(char * title) {
 	int y = LOSER_Y;
+
+	dl_abort();
 	clearBuffer(back_color);
-	if(drawString(x,y,"you quitter.",0,0) == -1) {
+	if(drawString(LOSER_X,y,title,0,0) == -1) {
 		return -1;
 	}
 	y += 8*CHAR_SIZE;
-	x += drawString(x,y,"score.",0,0);
-	x += 2*CHAR_SPACE;
-	y += 11;
-	if(drawNumber(x,y,player.score,colors[GREEN],0) == -1) {
+	if(drawLabeledNumber(LOSER_X,y,"score.",player.score) == -1) {
 		return -1;
 	}
-	x = LOSER_X;
-	y += 8*CHAR_SIZE;
-	x += drawString(x,y,"time played (sec).",0,0);
-	x += 2*CHAR_SPACE;
-	y += 11;
-	if(drawNumber(x,y,getPlayTime(),colors[GREEN],0) == -1) {
+	y += 8*CHAR_SIZE + 11;
+	if(drawLabeledNumber(LOSER_X,y,"time played (sec).",getPlayTime()) == -1) {
 		return -1;
 	}
 	drawBufferToScreen();
 	return 0;
 }
 
+int drawLoserScreen() {
+	return drawEndScreen("you kinda lost.");
+}
+
+int drawQuitScreen() {
+	return drawEndScreen("you quitter.");
+}
+
+int startEndScreen(int reason) {
+	getEndTime();
+	end_reason = reason;
+	end_phase = END_FADE_OUT;
+	end_ticks = 0;
+	option = END;
+	/* the end screen is drawn while the screen is black, then faded in */
+	palette_fade_out(PALETTE_FADE_TICKS);
+	return 0;
+}
+
+int endScreenTick(int fading) {
+	if(fading == 1) {
+		return 0;
+	}
+
+	switch(end_phase) {
+	case END_FADE_OUT:
+		if(((end_reason == -1) ? drawLoserScreen() : drawQuitScreen()) == -1) {
+			return -1;
+		}
+		palette_fade_in(PALETTE_FADE_TICKS);
+		end_phase = END_FADE_IN;
+		break;
+	case END_FADE_IN:
+		end_phase = END_HOLD;
+		break;
+	case END_HOLD:
+		if(++end_ticks >= END_HOLD_TICKS) {
+			resetGameVars();
+			option = MENU;
+		}
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
 long int getPlayTime() {
 	return (endDate.totalSeconds - startDate.totalSeconds);
 }
 
+//********************************************* GAME LOGIC ***************************
+int gameLogicTick() {
+	logic_ticks++;
+
+	updateRedSquare();
+
+	if(red_square_index == 1) {
+		if(first_round) {
+			first_round = 0;
+		}
+		else {
+			if(updatePlayerStatus() == -1) {
+				return -3;
+			}
+			if(checkPlayerStatus() == -1) { /* player has lost all of its lives */
+				return -1;
+			}
+		}
+		updatePlayerScore();
+		updateScenario();
+		updateSideMenu();
+	}
+
+	updatePlayerPosition();
+	checkPlayerCollision();
+
+	return 0;
+}
+
 //********************************************* INTERRUPTS ***************************
 int handleInterrupts(unsigned int * events) {
+	int lives, fading;
 
 	if((*events) & TIMER_IRQ_SET) {
 
-		if(timer.counter % 60) {
+		if(!clock_fixed && (timer.counter % 60)) {
 			game_rtc = rtc_get_date();
 		}
 
 		switch(option) {
 		case GAME:
+			dl_begin();
 			clearBuffer(0);
 			if(drawFrame() == -1) {
+				dl_abort();
 				return -3;
 			}
-			updateRedSquare();
 			if(drawString((0.20*HMAX),(0.92*VMAX),"keep in the safe color.",6,0) == -1) {
 				drawError("error in drawstring 'keep in the safe color'.");
 				return -3;
 			}
 
-			if(red_square_index == 1) {
-				if(first_round) {
-					first_round = 0;
-				}
-				else {
-					if(updatePlayerStatus() == -1) {
-						drawError("error in updateplayerstatus.");
-						return -3;
-					}
-					if(checkPlayerStatus() == -1) { /* player has lost all of its lives */
-						keyboard_set_leds(player.lives);
-						return -1;
-					}
-				}
-				updatePlayerScore();
-				updateScenario();
-				updateSideMenu();
+			lives = player.lives;
+			switch(gameLogicTick()) {
+			case -1: /* player has lost all of its lives */
+				dl_abort();
+				keyboard_set_leds(player.lives);
+				return -1;
+			case -3:
+				drawError("error in updateplayerstatus.");
+				return -3;
+			default:
+				break;
+			}
+			if(player.lives < lives) {
+				palette_flash(colors[RED], PALETTE_FLASH_TICKS);
 			}
-
-			updatePlayerPosition();
-			checkPlayerCollision();
 
 			keyboard_set_leds(player.lives);
 
@@ -1250,61 +1507,18 @@ int handleInterrupts(unsigned int * events) {
 				drawError("error in drawplayer.");
 				return -3;
 			}
-
-			break;
-		case MENU:
-			clearBuffer(back_color);
-			if(drawFrame() == -1) {
+			if(dl_end() == -1) {
+				drawError("error in dl_end.");
 				return -3;
 			}
-			if(drawMenu() == -1) {
-				drawError("error in drawsidemenu.");
-				return -4;
-			}
-			if(drawCursor() == -1) {
-				drawError("error in drawsidemenu.");
-				return -4;
-			}
+
 			break;
+		case MENU:
 		case MENU_HELP:
-			clearBuffer(back_color);
-			if(drawFrame() == -1) {
-				return -3;
-			}
-			if(drawMenuHelp() == -1) {
-				drawError("error in drawsidemenu.");
-				return -4;
-			}
-			if(drawCursor() == -1) {
-				drawError("error in drawsidemenu.");
-				return -4;
-			}
-			break;
 		case MENU_OPTIONS:
-			clearBuffer(back_color);
-			if(drawFrame() == -1) {
-				return -3;
-			}
-			if(drawMenuOptions() == -1) {
-				drawError("error in drawsidemenu.");
-				return -4;
-			}
-			if(drawCursor() == -1) {
-				drawError("error in drawsidemenu.");
-				return -4;
-			}
-			break;
 		case MENU_CREDITS:
-			clearBuffer(back_color);
-			if(drawFrame() == -1) {
-				return -3;
-			}
-			if(drawMenuCredits() == -1) {
-				drawError("error in drawsidemenu.");
-				return -4;
-			}
-			if(drawCursor() == -1) {
-				drawError("error in drawsidemenu.");
+			if(drawMenuScreen() == -1) {
+				drawError("error in drawmenuscreen.");
 				return -4;
 			}
 			break;
@@ -1312,6 +1526,15 @@ int handleInterrupts(unsigned int * events) {
 			break;
 		}
 		drawBufferToScreen();
+		fading = palette_tick();
+		if((option == END) && (endScreenTick(fading) == -1)) {
+			drawError("error in endscreentick.");
+			return -3;
+		}
+		/* on every screen change, then once a second */
+		if(vg_get_overdraw() && ((overdraw_screen != (int)option) || (timer.counter % 60 == 0))) {
+			printOverdraw();
+		}
 	}
 	if((*events) & KEYBOARD_IRQ_SET) {
 		if(keyboardHandle() == 1) {
@@ -1331,6 +1554,8 @@ int handleInterrupts(unsigned int * events) {
 			case GAME:
 				return -2;
 				break;
+			case END:
+				break;
 			default:
 				option = MENU;
 				break;
@@ -1422,122 +1647,117 @@ int initVars() {
 	cursor.size = cursor.width*CURSOR_PIX_SIZE;
 
 	// titles
-	char *str0 = malloc(10);
-	char *str1 = malloc(10);
-	char *str2 = malloc(10);
-	char *str3 = malloc(10);
-	char *str4 = malloc(10);
-	char *str5 = malloc(10);
-	char *str6 = malloc(10);
-	char *str7 = malloc(10);
-	char *str8 = malloc(10);
-	char *str9 = malloc(10);
-	char *str10 = malloc(10);
-	char *str11 = malloc(10);
-
-	strcpy(str0, "black division.");
 	titles[TITLE].x = MENU_X;
 	titles[TITLE].y = MENU_Y * (TITLE + 1);
-	titles[TITLE].title = str0;
+	titles[TITLE].title = "black division.";
 	titles[TITLE].hSize = BAR_LENGTH;
 	titles[TITLE].vSize = BAR_HEIGHT;
 	titles[TITLE].visible = 1;
 
-	strcpy(str1, "play.");
 	titles[PLAY].x = MENU_X;
 	titles[PLAY].y = MENU_Y * (PLAY + 1);
-	titles[PLAY].title = str1;
+	titles[PLAY].title = "play.";
 	titles[PLAY].hSize = BAR_LENGTH;
 	titles[PLAY].vSize = BAR_HEIGHT;
 	titles[PLAY].visible = 1;
 
-	strcpy(str11, "options.");
 	titles[OPTIONS].x = MENU_X;
 	titles[OPTIONS].y = MENU_Y * (OPTIONS + 1);
-	titles[OPTIONS].title = str11;
+	titles[OPTIONS].title = "options.";
 	titles[OPTIONS].hSize = BAR_LENGTH;
 	titles[OPTIONS].vSize = BAR_HEIGHT;
 	titles[OPTIONS].visible = 1;
 
-	strcpy(str2, "help.");
 	titles[HELP].x = MENU_X;
 	titles[HELP].y = MENU_Y * (HELP + 1);
-	titles[HELP].title = str2;
+	titles[HELP].title = "help.";
 	titles[HELP].hSize = BAR_LENGTH;
 	titles[HELP].vSize = BAR_HEIGHT;
 	titles[HELP].visible = 1;
 
-	strcpy(str3, "credits.");
 	titles[CREDITS].x = MENU_X;
 	titles[CREDITS].y = MENU_Y * (CREDITS + 1);
-	titles[CREDITS].title = str3;
+	titles[CREDITS].title = "credits.";
 	titles[CREDITS].hSize = BAR_LENGTH;
 	titles[CREDITS].vSize = BAR_HEIGHT;
 	titles[CREDITS].visible = 1;
 
-	strcpy(str4, "quit.");
 	titles[QUIT].x = MENU_X;
 	titles[QUIT].y = MENU_Y * (QUIT + 1);
-	titles[QUIT].title = str4;
+	titles[QUIT].title = "quit.";
 	titles[QUIT].hSize = BAR_LENGTH;
 	titles[QUIT].vSize = BAR_HEIGHT;
 	titles[QUIT].visible = 1;
 
-	strcpy(str5, "lives.");
 	bars[LIVES].x = GAME_X;
 	bars[LIVES].y = GAME_Y * (LIVES + 1);
-	bars[LIVES].title = str5;
+	bars[LIVES].title = "lives.";
 	bars[LIVES].hSize = BAR_LENGTH;
 	bars[LIVES].vSize = BAR_HEIGHT;
 	bars[LIVES].color = colors[GREEN];
 	bars[LIVES].visible = 1;
 
-	strcpy(str6, "power.");
 	bars[ENERGY].x = GAME_X;
 	bars[ENERGY].y = GAME_Y * (ENERGY + 1);
-	bars[ENERGY].title = str6;
+	bars[ENERGY].title = "power.";
 	bars[ENERGY].hSize = BAR_LENGTH;
 	bars[ENERGY].vSize = BAR_HEIGHT;
 	bars[ENERGY].color = colors[BLUE];
 	bars[ENERGY].visible = 1;
 
-	strcpy(str7, "safe color.");
 	bars[SAFE_COLOR].x = GAME_X;
 	bars[SAFE_COLOR].y = GAME_Y * (SAFE_COLOR + 1);
-	bars[SAFE_COLOR].title = str7;
+	bars[SAFE_COLOR].title = "safe color.";
 	bars[SAFE_COLOR].hSize = BAR_LENGTH;
 	bars[SAFE_COLOR].vSize = 8*BAR_HEIGHT;
 	bars[SAFE_COLOR].color = colors_faded[WHITE];
 	bars[SAFE_COLOR].visible = 1;
 
-	strcpy(str8, "score.");
 	bars[SCORE].x = GAME_X;
 	bars[SCORE].y = GAME_Y * (SCORE + 1) + bars[SAFE_COLOR].vSize;
-	bars[SCORE].title = str8;
+	bars[SCORE].title = "score.";
 	bars[SCORE].hSize = (BAR_LENGTH/2);
 	bars[SCORE].vSize = BAR_HEIGHT;
 	bars[SCORE].color = colors[WHITE];
 	bars[SCORE].visible = 1;
 
-	strcpy(str9, "level.");
 	bars[LEVEL].x = GAME_X;
 	bars[LEVEL].y = GAME_Y * (LEVEL + 1) + bars[SAFE_COLOR].vSize;
-	bars[LEVEL].title = str9;
+	bars[LEVEL].title = "level.";
 	bars[LEVEL].hSize = (BAR_LENGTH/2);
 	bars[LEVEL].vSize = BAR_HEIGHT;
 	bars[LEVEL].color = colors[WHITE];
 	bars[LEVEL].visible = 1;
 
-	strcpy(str10, "next level.");
 	bars[NEXT_LVL].x = GAME_X;
 	bars[NEXT_LVL].y = GAME_Y * (NEXT_LVL + 1) + bars[SAFE_COLOR].vSize;
-	bars[NEXT_LVL].title = str10;
+	bars[NEXT_LVL].title = "next level.";
 	bars[NEXT_LVL].hSize = (3*BAR_LENGTH/4);
 	bars[NEXT_LVL].vSize = BAR_HEIGHT;
 	bars[NEXT_LVL].color = colors[WHITE];
 	bars[NEXT_LVL].visible = 1;
 
-	keyboard_set_leds(player.lives);
+	return 0;
+}
+
+int initScreens() {
+	// glyphs
+	font_cache_warm(text_sizes, sizeof(text_sizes) / sizeof(text_sizes[0]), CHAR_COLOR);
+	font_cache_warm(text_sizes, sizeof(text_sizes) / sizeof(text_sizes[0]), DATE_COLOR);
+
+	// sprites
+	if(player_image == NULL) {
+		player_image = sprite_compile(&player.sprite[0][0], player.width, player.height, sizeof(player.sprite[0]),
+				PLAYER_PIX_SIZE, player_colors, sizeof(player_colors) / sizeof(player_colors[0]));
+	}
+	if(cursor_image == NULL) {
+		cursor_image = sprite_compile(&cursor.sprite[0][0], cursor.width, cursor.width, sizeof(cursor.sprite[0]),
+				CURSOR_PIX_SIZE, cursor_colors, sizeof(cursor_colors) / sizeof(cursor_colors[0]));
+	}
+	cursor_overlay.sprite = cursor_image;
+
+	// menus, drawn again with the titles above
+	invalidateMenuLayers();
 
 	return 0;
 }
@@ -1585,6 +1805,8 @@ int gameLoop(const short int debugmode) {
 	debug = debugmode;
 
 	initVars();
+	initScreens();
+	keyboard_set_leds(player.lives);
 
 	while(!toBreak) {
 
@@ -1601,6 +1823,9 @@ int gameLoop(const short int debugmode) {
 					}
 					if (msg.NOTIFY_ARG & KEYBOARD_IRQ_SET) { // KEYBOARD interrupt
 						keyboard.code = keyboard_scan();
+						if((input_record != NULL) && (option == GAME)) {
+							fprintf(input_record, "%lu %x\n", logic_ticks, keyboard.code);
+						}
 						events = events | KEYBOARD_IRQ_SET;
 					}
 					if (msg.NOTIFY_ARG & MOUSE_IRQ_SET) { // MOUSE interrupt
@@ -1624,15 +1849,12 @@ int gameLoop(const short int debugmode) {
 
 		if(toBreak < 0) {
 			if(toBreak > -3) { // player has lost/quit
-				getEndTime();
-				(toBreak == -1) ? drawLoserScreen() : drawQuitScreen();
-				sleep(2);
-				resetGameVars();
+				startEndScreen(toBreak);
 				toBreak = 0;
-				option = MENU;
 			}
 			else if(toBreak == -3) {
 				sleep(2);
+				palette_reset();
 				resetGameVars();
 				toBreak = 0;
 				option = MENU;
@@ -1645,9 +1867,392 @@ int gameLoop(const short int debugmode) {
 	}
 
 	keyboard_set_leds(ZERO);
+
+	if(input_record != NULL) {
+		fprintf(input_record, "%lu end\n", logic_ticks);
+		fclose(input_record);
+		input_record = NULL;
+	}
+	return 0;
+}
+
+//********************************************* SIMULATION ***************************
+int recordInput(const char *path, unsigned int seed) {
+	if((input_record = fopen(path, "w")) == NULL) {
+		return -1;
+	}
+	fprintf(input_record, "seed %u\n", seed);
+	return 0;
+}
+
+int readRecordedKey(FILE *input, unsigned long *tick, unsigned long *code) {
+	char line[64], word[8];
+
+	if((fgets(line, sizeof(line), input) == NULL) || (sscanf(line, "%lu %7s", tick, word) != 2)) {
+		return -1;
+	}
+	if(strcmp(word, "end") == 0) {
+		return 1;
+	}
+	*code = strtoul(word, NULL, 16);
 	return 0;
 }
 
+unsigned long simStateHash() {
+	unsigned long hash = 2166136261UL;
+	long values[16];
+	unsigned int i;
+
+	values[0] = player.x;
+	values[1] = player.y;
+	values[2] = player.score;
+	values[3] = player.lives;
+	values[4] = player.power;
+	values[5] = lvl;
+	values[6] = difficulty;
+	values[7] = red_square_index;
+	for(i = 0; i < 8; i++) {
+		values[8 + i] = hole_color[i];
+	}
+
+	for(i = 0; i < 16; i++) {
+		hash = ((hash ^ (unsigned long)values[i]) * 16777619UL) & 0xFFFFFFFFUL;
+	}
+	return hash;
+}
+
+int simLoop(unsigned long ticks, const char *replay) {
+	static const unsigned long directions[] = { MAKECODE_W, MAKECODE_A, MAKECODE_S, MAKECODE_D };
+	unsigned long steps = 0, games = 0, keys = 0, next_tick = 0, next_code = 0;
+	unsigned int seed, random = 1;
+	int next = -1, ret = 0;
+	long best_score = 0;
+	FILE *input = NULL;
+	char line[64];
+	clock_t start;
+	double seconds;
+
+	if(replay != NULL) {
+		if(((input = fopen(replay, "r")) == NULL) || (fgets(line, sizeof(line), input) == NULL) ||
+				(sscanf(line, "seed %u", &seed) != 1)) {
+			printf("-> sim: %s is not an input recording \n", replay);
+			if(input != NULL) {
+				fclose(input);
+			}
+			return -1;
+		}
+		srand(seed);
+		next = readRecordedKey(input, &next_tick, &next_code);
+	}
+
+	initVars();
+	option = GAME;
+
+	start = clock();
+	while((ticks == 0) || (steps < ticks)) {
+		/* keys reach the game between timer interrupts, so before the step they were recorded at */
+		if(input != NULL) {
+			while((next == 0) && (next_tick == logic_ticks)) {
+				keyboard.code = next_code;
+				keys++;
+				if(keyboardHandle() == 1) { /* player has quit */
+					games++;
+					resetGameVars();
+				}
+				next = readRecordedKey(input, &next_tick, &next_code);
+			}
+			if((next == -1) || ((next == 1) && (next_tick == logic_ticks))) {
+				break;
+			}
+		}
+		else if(steps % SIM_KEY_TICKS == 0) {
+			random = random * 1103515245 + 12345;
+			keyboard.code = directions[(random >> 16) % 4];
+			keys++;
+			keyboardHandle();
+		}
+
+		ret = gameLogicTick();
+		steps++;
+		if(player.score > best_score) {
+			best_score = player.score;
+		}
+		if(ret == -3) {
+			printf("-> sim: error in updateplayerstatus \n");
+			break;
+		}
+		if(ret == -1) { /* player has lost */
+			games++;
+			resetGameVars();
+		}
+	}
+	seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	if(input != NULL) {
+		fclose(input);
+	}
+
+	printf("-> sim: %lu ticks in %.3f s, %.0f ticks/s \n", steps, seconds, (seconds > 0) ? steps / seconds : 0.0);
+	printf("-> sim: %lu games ended, best score %ld, %lu keys, state %08lx \n", games, best_score, keys, simStateHash());
+
+	return (ret == -3) ? -1 : 0;
+}
+
+//********************************************* GOLDEN FRAMES ************************
+/** @name Golden Step */
+/**@{
+ *
+ * Screen shown for a number of frames by the golden frame script
+ */
+typedef struct {
+	const char *name;		/**< @brief Name of the step in the golden file. */
+	unsigned int screen;	/**< @brief Menu option shown. */
+	unsigned int frames;	/**< @brief Frames shown; 0 plays a game until it is lost. */
+} GOLDEN_STEP;
+/** @} end of Golden Step */
+
+const GOLDEN_STEP golden_script[] = {
+	{ "menu", MENU, 30 },
+	{ "help", MENU_HELP, 30 },
+	{ "options", MENU_OPTIONS, 20 },
+	{ "credits", MENU_CREDITS, 30 },
+	{ "menu", MENU, 20 },
+	{ "round1", GAME, GOLDEN_ROUND_FRAMES },
+	{ "round2", GAME, 0 },
+	{ "round3", GAME, GOLDEN_ROUND_FRAMES }
+};	/**< @brief Screens the golden frame run goes through, in order. */
+const unsigned int golden_steps = sizeof(golden_script) / sizeof(golden_script[0]);	/**< @brief Number of steps of golden_script. */
+
+unsigned long goldenFrameHash(unsigned char *pixels, unsigned long size) {
+	vg_rect_t rect = { 0, 0, HMAX, VMAX };
+	unsigned long hash = 2166136261UL, i;
+
+	vg_read_rect(NULL, &rect, pixels, size / (VMAX / vg_get_render_scale()));
+	for(i = 0; i < size; i++) {
+		hash = ((hash ^ pixels[i]) * 16777619UL) & 0xFFFFFFFFUL;
+	}
+	return hash;
+}
+
+void goldenClock(unsigned long frame) {
+	unsigned long seconds = (frame / 60) % 60, minutes = (frame / 3600) % 60;
+
+	/* the registers are BCD; noon of 1/1/2014 */
+	game_rtc.data[RTC_SEC] = ((seconds / 10) << 4) | (seconds % 10);
+	game_rtc.data[RTC_MIN] = ((minutes / 10) << 4) | (minutes % 10);
+	game_rtc.data[RTC_HOUR] = 0x12;
+	game_rtc.data[RTC_DAY_WEEK] = 0x04;
+	game_rtc.data[RTC_DAY_MONTH] = 0x01;
+	game_rtc.data[RTC_MONTH] = 0x01;
+	game_rtc.data[RTC_YEAR] = 0x14;
+}
+
+int goldenFrame(FILE *golden, int record, int times, const char *name, unsigned long frame, unsigned long hash, unsigned long cycles, unsigned long *golden_cycles) {
+	char line[64], golden_name[16];
+	unsigned long golden_frame, golden_hash;
+
+	if(record) {
+		if(times) {
+			fprintf(golden, "%s %lu %08lx %lu\n", name, frame, hash, cycles);
+		}
+		else {
+			fprintf(golden, "%s %lu %08lx\n", name, frame, hash);
+		}
+		*golden_cycles = times ? cycles : 0;
+		return 0;
+	}
+
+	/* the time is left out of files meant for other machines */
+	*golden_cycles = 0;
+	if((fgets(line, sizeof(line), golden) == NULL) ||
+			(sscanf(line, "%15s %lu %lx %lu", golden_name, &golden_frame, &golden_hash, golden_cycles) < 3)) {
+		return -1;
+	}
+
+	return ((strcmp(name, golden_name) == 0) && (frame == golden_frame) && (hash == golden_hash)) ? 0 : -1;
+}
+
+int compareTimes(const void *a, const void *b) {
+	unsigned long x = *(const unsigned long *)a, y = *(const unsigned long *)b;
+
+	return (x > y) - (x < y);
+}
+
+unsigned long goldenMedian(unsigned long *times, unsigned long count) {
+	if(count == 0) {
+		return 0;
+	}
+	qsort(times, count, sizeof(unsigned long), compareTimes);
+	return times[count / 2];
+}
+
+int goldenLoop(const char *path, int record, int times, int tolerance) {
+	static const unsigned long directions[] = { MAKECODE_W, MAKECODE_A, MAKECODE_S, MAKECODE_D };
+	unsigned long frame = 0, step_frames, changed = 0, hash, size, timed, median, golden_median;
+	unsigned long *cycles, *golden_cycles;
+	unsigned int step, events, random = 1, slower = 0, bytes, scale, golden_bytes, golden_scale;
+	const char *end_name;
+	unsigned char *pixels;
+	char line[64];
+	FILE *golden;
+	unsigned long long start;
+	int ret = 0;
+
+	bytes = vg_get_bytes_per_pixel();
+	scale = vg_get_render_scale();
+	size = (HMAX / scale) * (VMAX / scale) * bytes;
+	pixels = calloc(size, 1);
+	/* every frame of a step, and its end screen */
+	cycles = malloc(sizeof(unsigned long) * (GOLDEN_LOSE_FRAMES + 2));
+	golden_cycles = malloc(sizeof(unsigned long) * (GOLDEN_LOSE_FRAMES + 2));
+	if((pixels == NULL) || (cycles == NULL) || (golden_cycles == NULL)) {
+		free(pixels);
+		free(cycles);
+		free(golden_cycles);
+		return -1;
+	}
+
+	if((golden = fopen(path, record ? "w" : "r")) == NULL) {
+		printf("-> golden: %s could not be opened \n", path);
+		free(pixels);
+		free(cycles);
+		free(golden_cycles);
+		return -1;
+	}
+	if(record) {
+		fprintf(golden, "golden %u bytes %u scale\n", bytes, scale);
+	}
+	else if((fgets(line, sizeof(line), golden) == NULL) || (sscanf(line, "golden %u bytes %u scale", &golden_bytes, &golden_scale) != 2) ||
+			(golden_bytes != bytes) || (golden_scale != scale)) {
+		printf("-> golden: %s was not recorded with %u bytes per pixel and scale %u \n", path, bytes, scale);
+		fclose(golden);
+		free(pixels);
+		free(cycles);
+		free(golden_cycles);
+		return -1;
+	}
+
+	srand(GOLDEN_SEED);
+	initVars();
+	initScreens();
+	clock_fixed = 1;
+
+	for(step = 0; step < golden_steps; step++) {
+		option = golden_script[step].screen;
+		if(option == GAME) {
+			getStartTime();
+		}
+		end_name = NULL;
+		timed = 0;
+
+		for(step_frames = 0; (golden_script[step].frames == 0) || (step_frames < golden_script[step].frames); step_frames++) {
+			goldenClock(frame);
+			timer.counter++;
+			events = TIMER_IRQ_SET;
+			if(option == GAME) {
+				if(frame % SIM_KEY_TICKS == 0) {
+					random = random * 1103515245 + 12345;
+					keyboard.code = directions[(random >> 16) % 4];
+					events |= KEYBOARD_IRQ_SET;
+				}
+			}
+			else {
+				/* the cursor sweeps the menu */
+				mouse.x = 1 + (frame * 7) % (HMAX - cursor.size);
+				mouse.y = 1 + (frame * 5) % (VMAX - cursor.size);
+			}
+
+			start = mem_read_cycles();
+			ret = handleInterrupts(&events);
+			cycles[timed] = mem_read_cycles() - start;
+
+			if((ret != 0) && (ret != -1)) {
+				printf("-> golden: step %s ended at frame %lu (%d) \n", golden_script[step].name, frame, ret);
+				ret = -1;
+				break;
+			}
+			if(ret == -1) { /* lost: the frame is not presented */
+				end_name = "loser";
+				ret = 0;
+				break;
+			}
+
+			hash = goldenFrameHash(pixels, size);
+			if(goldenFrame(golden, record, times, golden_script[step].name, frame, hash, cycles[timed], &golden_cycles[timed]) != 0) {
+				if(changed++ < GOLDEN_REPORT) {
+					printf("-> golden: frame %lu of %s changed (%08lx) \n", frame, golden_script[step].name, hash);
+				}
+			}
+			timed++;
+			frame++;
+
+			if((golden_script[step].frames == 0) && (step_frames >= GOLDEN_LOSE_FRAMES)) {
+				printf("-> golden: step %s was not lost in %u frames \n", golden_script[step].name, GOLDEN_LOSE_FRAMES);
+				ret = -1;
+				break;
+			}
+		}
+		if(ret != 0) {
+			break;
+		}
+
+		if(option == GAME) {
+			if(end_name == NULL) { /* the player quits */
+				keyboard.code = MAKECODE_ESC;
+				events = KEYBOARD_IRQ_SET;
+				handleInterrupts(&events);
+				end_name = "quit";
+			}
+			getEndTime();
+			start = mem_read_cycles();
+			(strcmp(end_name, "loser") == 0) ? drawLoserScreen() : drawQuitScreen();
+			cycles[timed] = mem_read_cycles() - start;
+			hash = goldenFrameHash(pixels, size);
+			if(goldenFrame(golden, record, times, end_name, frame, hash, cycles[timed], &golden_cycles[timed]) != 0) {
+				if(changed++ < GOLDEN_REPORT) {
+					printf("-> golden: frame %lu of %s changed (%08lx) \n", frame, end_name, hash);
+				}
+			}
+			timed++;
+			frame++;
+			palette_reset();
+			resetGameVars();
+		}
+
+		/* the median frame of a step, single frames are too short and too often interrupted to compare */
+		median = goldenMedian(cycles, timed);
+		golden_median = goldenMedian(golden_cycles, timed);
+		printf("-> golden: %-8s %5lu frames, median %9lu cycles", golden_script[step].name, step_frames, median);
+		/* times of another machine, or of a file recorded without them, are not compared */
+		if(!record && (tolerance >= 0) && (golden_median > 0)) {
+			printf(", golden %9lu cycles", golden_median);
+			if(median > golden_median * (100 + tolerance) / 100 + GOLDEN_SLACK_CYCLES) {
+				printf(" SLOWER");
+				slower++;
+			}
+		}
+		printf(" \n");
+	}
+
+	if(!record && (ret == 0) && (fgets(line, sizeof(line), golden) != NULL)) {
+		printf("-> golden: %s has frames after frame %lu \n", path, frame);
+		ret = -1;
+	}
+
+	clock_fixed = 0;
+	fclose(golden);
+	free(pixels);
+	free(cycles);
+	free(golden_cycles);
+
+	if(record) {
+		printf("-> golden: %lu frames recorded to %s \n", frame, path);
+		return ret;
+	}
+	printf("-> golden: %lu frames, %lu changed, %u steps slower \n", frame, changed, slower);
+	return ((ret == 0) && (changed == 0) && (slower == 0)) ? 0 : -1;
+}
+
 
 
 
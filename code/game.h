@@ -2,6 +2,7 @@
 #define GAME_H_
 
 #include "libraries.h"
+#include "video_gr.h"
 
 /** @defgroup game game
  * @{
@@ -20,6 +21,17 @@
 #define	NEXT_LEVEL_SCORE	200		/**< @brief base score to multiply by level and difficulty to define the next level */
 #define BASE_DIFF_MULT		8		/**< @brief multiplier associated with the difficulty's increase ratio */
 
+/* SIMULATION */
+#define SIM_TICKS		1000000	/**< @brief Default number of logic steps of a simulation */
+#define SIM_KEY_TICKS	20		/**< @brief Logic steps between the synthetic keys of a simulation */
+
+/* GOLDEN FRAMES */
+#define GOLDEN_SEED			1		/**< @brief Seed of the game's random numbers in golden frame runs */
+#define GOLDEN_ROUND_FRAMES	600		/**< @brief Frames of a golden frame round which ends with the player quitting */
+#define GOLDEN_LOSE_FRAMES	6000	/**< @brief Frames a golden frame round played until it is lost may take */
+#define GOLDEN_SLACK_CYCLES	20000	/**< @brief Cycles the median frame of any step may be slower by, so fast steps do not fail on noise */
+#define GOLDEN_REPORT		10		/**< @brief Changed frames printed by a check */
+
 /* MENU CONTENT */
 #define	MENU_X		(0.10 * HMAX)	/**< @brief Main Menu initial x border */
 #define MENU_Y		(0.10 * VMAX)	/**< @brief Main Menu initial y border */
@@ -36,10 +48,15 @@
 #define	GAME_X		(0.70 * HMAX)	/**< @brief Game initial x border */
 #define GAME_Y		(0.10 * VMAX)	/**< @brief Game initial y border */
 
+#define	DATE_X		(0.70 * HMAX)	/**< @brief Main Menu date initial x border */
+#define DATE_Y		(0.10 * VMAX)	/**< @brief Main Menu date initial y border */
+
 #define	LOSER_X		(0.05 * HMAX)	/**< @brief Loser/Quitter Menu initial x border */
 #define LOSER_Y		(0.02 * VMAX)	/**< @brief Loser/Quitter Menu initial y border */
+#define END_HOLD_TICKS	120		/**< @brief Timer ticks the Loser/Quitter Menu is shown for, once faded in */
 
 #define CHAR_COLOR		55	/**< @brief Default color for characters */
+#define DATE_COLOR		7	/**< @brief Color of the date and hour */
 #define CHAR_SIZE		8	/**< @brief Default size for characters */
 #define CHAR_SPACE		12	/**< @brief Default space between non-numerical characters */
 #define NUM_SPACE		14	/**< @brief Default space between numerical characters */
@@ -116,7 +133,9 @@ int debugTestWrite(int x, int y, int number);
  * @param size character size
  * @param color character color
  *
- * @return 0 if success, -1 otherwise
+ * The string is laid out once by the text module and then replayed.
+ *
+ * @return horizontal advance of the last line, -1 on error
  */
 int drawString(int x, int y, char * str, int size, unsigned int color);
 /**
@@ -151,6 +170,10 @@ int clearScreen(unsigned int x, unsigned int y, unsigned int xf, unsigned int yf
  * @return 0 if success, -1 otherwise
  */
 int drawError(char * str);
+/**
+ * @brief Prints the overdraw of the last frame: the most writes to a pixel and the mean. ONLY FOR DEBUG.
+ */
+void printOverdraw();
 /**
  * @brief Updates struct startDate with the data from the Real Time Clock (rtc) in the beginning of the game.
  */
@@ -264,6 +287,28 @@ int updateSideMenu();
  * @return 0 if success
  */
 int updateScenario();
+/**
+ * @brief Brings the board layer up to date with the current round.
+ *
+ * The layer is redrawn when the division colors change or the red square restarts,
+ * otherwise only the rings swept by the red square since the last call are added.
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int updateBoard();
+/**
+ * @brief Draws a band of consecutive board rings as eight filled divisions.
+ *
+ * Each division is one convex polygon fill instead of one line per ring.
+ *
+ * @param inner index of the innermost ring of the band
+ * @param outer index of the outermost ring of the band
+ * @param origin_x x of the board in the current render target
+ * @param origin_y y of the board in the current render target
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int drawBoard(unsigned int inner, unsigned int outer, int origin_x, int origin_y);
 /**
  * @brief Draws the scenario to the buffer.
 
@@ -313,11 +358,42 @@ int drawCursor();
  */
 int drawFrame();
 /**
- * @brief Draws the main menu to the buffer.
+ * @brief Draws the main menu titles to the buffer. The date is drawn apart, by drawMenuScreen().
  *
  * @return 0 if success, -1 otherwise
  */
 int drawMenu();
+/**
+ * @brief Brings the current menu screen up to date in the buffer.
+ *
+ * The menu's static layer is copied when the menu option changes, the date is
+ * redrawn over its own part of the layer when it changes, and otherwise just
+ * the cursor overlay is moved, so only its old and new rectangles are damaged.
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int drawMenuScreen();
+/**
+ * @brief Returns the static layer of a menu screen: its background, frame and text.
+ *
+ * The layer is drawn the first time it is needed, and again after invalidateMenuLayers()
+ * or when the colors' pixel values change.
+ *
+ * @param screen menu option (MENU, MENU_HELP, MENU_OPTIONS or MENU_CREDITS)
+ *
+ * @return the layer, NULL on error
+ */
+vg_surface_t *getMenuLayer(unsigned int screen);
+/**
+ * @brief Marks every menu layer as stale. Needed whenever the titles or back_color change.
+ */
+void invalidateMenuLayers();
+/**
+ * @brief Returns the date shown by the main menu as a single number, to detect when it changes.
+ *
+ * @return seconds since the start of the month
+ */
+long getMenuDate();
 /**
  * @brief Draws the date and hour to the buffer.
  *
@@ -342,6 +418,25 @@ int drawMenuOptions();
  * @return 0 if success, -1 otherwise
  */
 int drawMenuCredits();
+/**
+ * @brief Draws a label followed by a number, as shown by the loser and quitter screens.
+ *
+ * @param x label's x coordinate
+ * @param y label's y coordinate
+ * @param label label string
+ * @param number number shown after the label
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int drawLabeledNumber(int x, int y, char * label, long int number);
+/**
+ * @brief Draws the screen shown when a game ends, with its score and time played, and presents it.
+ *
+ * @param title first line of the screen
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int drawEndScreen(char * title);
 /**
  * @brief Draws the loser screen to the buffer.
  *
@@ -354,12 +449,38 @@ int drawLoserScreen();
  * @return 0 if success, -1 otherwise
  */
 int drawQuitScreen();
+/**
+ * @brief Starts the transition to the loser or quitter screen: a fade out, the screen, a fade in and a wait.
+ *
+ * The transition is driven by endScreenTick(), from the timer interrupts, and ends in the main menu.
+ *
+ * @param reason -1 if the player has lost, -2 if the player has quit
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int startEndScreen(int reason);
+/**
+ * @brief Advances the transition started by startEndScreen(), once per timer tick.
+ *
+ * @param fading value returned by palette_tick() on this tick
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int endScreenTick(int fading);
 /**
  * @brief Gets the play time, using the information in the structs startDate and endDate.
  *
  * @return play time
  */
 long int getPlayTime();
+/**
+ * @brief Advances the game by one timer tick: the red square, the player's status and score, the scenario and the player's position.
+ *
+ * Draws nothing, so it runs the same with or without a screen.
+ *
+ * @return 0 if success, -1 if player has lost, -3 on error
+ */
+int gameLogicTick();
 /**
  * @brief Handles all interruptions and game order logic.
  *
@@ -380,6 +501,12 @@ int initVars();
  * @return 0 if success
  */
 int resetGameVars();
+/**
+ * @brief Initializes what the screens need to be drawn: cached glyphs, sprites and menu layers.
+ *
+ * @return 0 if success
+ */
+int initScreens();
 /**
  * @brief Main game loop. Receives the interrupts and calls handleInterrupts().
  *
@@ -388,5 +515,105 @@ int resetGameVars();
  * @return 0 if success, -1 otherwise
  */
 int gameLoop(const short int debugmode);
+/**
+ * @brief Records the keys pressed while playing, for simLoop() to replay.
+ *
+ * The file holds the seed, then one line per key: the number of logic steps done before it and its scancode.
+ *
+ * @param path file to write
+ * @param seed seed given to srand()
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int recordInput(const char *path, unsigned int seed);
+/**
+ * @brief Reads the next key of an input recording.
+ *
+ * @param input recording, after its seed
+ * @param tick logic steps done before the key, or before the recording ended
+ * @param code scancode of the key
+ *
+ * @return 0 if a key was read, 1 at the end of the recording, -1 on error
+ */
+int readRecordedKey(FILE *input, unsigned long *tick, unsigned long *code);
+/**
+ * @brief Gets a hash of the game state, to compare simulations.
+ *
+ * @return the hash
+ */
+unsigned long simStateHash();
+/**
+ * @brief Steps the game logic as fast as possible, without drawing or interrupts, and prints the ticks per second.
+ *
+ * Lost and quit games are reset and play goes on.
+ *
+ * @param ticks number of logic steps, 0 to run a replay to its end
+ * @param replay input recording to replay, or NULL for synthetic input: a direction key every SIM_KEY_TICKS steps
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int simLoop(unsigned long ticks, const char *replay);
+/**
+ * @brief Hashes the video buffer, read back with vg_read_rect().
+ *
+ * @param pixels where to read the buffer to
+ * @param size bytes of the buffer at the render scale
+ *
+ * @return FNV-1a hash of the buffer's pixels
+ */
+unsigned long goldenFrameHash(unsigned char *pixels, unsigned long size);
+/**
+ * @brief Sets game_rtc to a fixed date, one second later every 60 frames.
+ *
+ * @param frame frame of the golden frame run
+ */
+void goldenClock(unsigned long frame);
+/**
+ * @brief Records a frame to a golden file, or compares it with the next frame of one.
+ *
+ * @param golden golden file
+ * @param record 1 to write the frame, 0 to read and compare
+ * @param times 1 to write the frame's time along with its hash
+ * @param name name of the step the frame belongs to
+ * @param frame index of the frame in the run
+ * @param hash hash of the frame
+ * @param cycles CPU cycles taken to draw and present the frame
+ * @param golden_cycles returns the golden time of the frame, 0 if there is none
+ *
+ * @return 0 if the frame is the golden one, -1 otherwise
+ */
+int goldenFrame(FILE *golden, int record, int times, const char *name, unsigned long frame, unsigned long hash, unsigned long cycles, unsigned long *golden_cycles);
+/**
+ * @brief Compares two frame times, for qsort().
+ */
+int compareTimes(const void *a, const void *b);
+/**
+ * @brief Gets the median of frame times.
+ *
+ * @param times frame times, sorted in place
+ * @param count number of times
+ *
+ * @return the median, 0 if there are no times
+ */
+unsigned long goldenMedian(unsigned long *times, unsigned long count);
+/**
+ * @brief Drives the game through golden_script (menus, game rounds and their end screens) and records or checks every frame.
+ *
+ * Input is synthetic and the clock is fixed, so a run always draws the same
+ * frames. Each frame's video buffer is hashed, and the CPU cycles taken to draw
+ * and present it are counted. The hashes decide whether a check passes; times
+ * are only compared when asked to, against a file recorded on the same machine,
+ * by the median frame of each step, as single frames are too short and too often
+ * interrupted to be compared.
+ * Palette fades are not run, they do not change the video buffer.
+ *
+ * @param path golden file
+ * @param record 1 to record the golden file, 0 to check the run against it
+ * @param times 1 to record the frame times along with the hashes
+ * @param tolerance percent the median frame of a step may be slower than its golden time, -1 to not compare times
+ *
+ * @return 0 if every frame matches and no step is slower, -1 otherwise
+ */
+int goldenLoop(const char *path, int record, int times, int tolerance);
 
 #endif	/* GAME_H_ */
@@ -0,0 +1,121 @@
+/*
+ * fb_shm.c
+ *
+ * Framebuffer of the host build, in a POSIX shared memory segment when
+ * HOST_FB names one and in process memory otherwise.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "host.h"
+#include "fb.h"
+#include "fb_shm.h"
+
+static unsigned char *vram = NULL;			/**< @brief The framebuffer, HOST_VRAM_SIZE bytes */
+static fb_shm_header_t *header = NULL;		/**< @brief Header of the segment, NULL without one */
+static unsigned int writers = 0;			/**< @brief Nesting of write_begin() calls */
+
+/**
+ * @brief Map the segment named by HOST_FB, creating it if needed.
+ */
+static unsigned char *shm_map(const char *name) {
+	unsigned long size = FB_SHM_PIXELS + HOST_VRAM_SIZE;
+	unsigned char *segment;
+	int fd;
+
+	if((fd = shm_open(name, O_RDWR | O_CREAT, 0600)) == -1) {
+		return NULL;
+	}
+	if(ftruncate(fd, size) == -1) {
+		close(fd);
+		return NULL;
+	}
+	segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(segment == MAP_FAILED) {
+		return NULL;
+	}
+
+	header = (fb_shm_header_t *)segment;
+	memset(header, 0, sizeof(fb_shm_header_t));
+	header->version = FB_SHM_VERSION;
+	header->size = HOST_VRAM_SIZE;
+	/* readers check the magic last */
+	__atomic_store_n(&header->magic, FB_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	return segment + FB_SHM_PIXELS;
+}
+
+unsigned char *host_fb_vram() {
+	const char *name;
+
+	if(vram != NULL) {
+		return vram;
+	}
+
+	if(((name = getenv("HOST_FB")) != NULL) && ((vram = shm_map(name)) == NULL)) {
+		fprintf(stderr, "host: cannot map the framebuffer segment %s, using process memory\n", name);
+	}
+	if(vram == NULL) {
+		vram = calloc(1, HOST_VRAM_SIZE);
+	}
+
+	return vram;
+}
+
+/**
+ * @brief Make the sequence odd, unless a write is already open.
+ */
+static void write_begin() {
+	if((header == NULL) || (writers++ > 0)) {
+		return;
+	}
+	__atomic_store_n(&header->sequence, header->sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Make the sequence even again, publishing everything written.
+ */
+static void write_end() {
+	if((header == NULL) || (--writers > 0)) {
+		return;
+	}
+	__atomic_store_n(&header->sequence, header->sequence + 1, __ATOMIC_RELEASE);
+}
+
+void host_fb_mode(const host_screen_t *screen) {
+	if(header == NULL) {
+		return;
+	}
+
+	write_begin();
+	header->width = screen->width;
+	header->height = screen->height;
+	header->pitch = screen->pitch;
+	header->bits_per_pixel = screen->bits_per_pixel;
+	header->dac_width = screen->dac_width;
+	memcpy(header->palette, screen->dac, sizeof(header->palette));
+	write_end();
+}
+
+void host_fb_palette(unsigned int first, unsigned int count, const unsigned char rgb[][3]) {
+	if(header == NULL) {
+		return;
+	}
+
+	write_begin();
+	memcpy(header->palette[first], rgb[first], count * 3);
+	write_end();
+}
+
+void fb_present_begin() {
+	write_begin();
+}
+
+void fb_present_end() {
+	if(header != NULL) {
+		header->frame++;
+	}
+	write_end();
+}
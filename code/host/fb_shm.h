@@ -0,0 +1,48 @@
+#ifndef FB_SHM_H_
+#define FB_SHM_H_
+
+#include <stdint.h>
+
+/** @defgroup fb_shm fb_shm
+ * @{
+ *
+ * Layout of the shared memory segment host builds present to, when HOST_FB
+ * names one (e.g. HOST_FB=/black_division).
+ *
+ * The segment starts with a header and holds the emulated framebuffer
+ * FB_SHM_PIXELS bytes in. The game writes the framebuffer in place, so
+ * presenting costs what it costs on VBE hardware plus a sequence bump.
+ *
+ * The header is a sequence lock: sequence is odd while the game writes the
+ * framebuffer, the palette or the mode, and is incremented again when done.
+ * A reader copies what it needs, then checks that sequence was even and has
+ * not changed; otherwise it copies again.
+ */
+
+#define FB_SHM_MAGIC	0x46424442	/**< @brief "BDBF", first word of the segment */
+#define FB_SHM_VERSION	1			/**< @brief Version of this layout */
+#define FB_SHM_PIXELS	4096		/**< @brief Offset of the framebuffer in the segment */
+
+/** @name Header */
+/**@{
+ *
+ * Start of the segment
+ */
+typedef struct {
+	uint32_t magic;				/**< @brief FB_SHM_MAGIC */
+	uint32_t version;			/**< @brief FB_SHM_VERSION */
+	uint32_t sequence;			/**< @brief Sequence lock, odd while the segment is written */
+	uint32_t frame;				/**< @brief Frames presented so far */
+	uint32_t width;				/**< @brief Horizontal resolution, 0 until a mode is set */
+	uint32_t height;			/**< @brief Vertical resolution */
+	uint32_t pitch;				/**< @brief Bytes per row of the framebuffer */
+	uint32_t bits_per_pixel;	/**< @brief 8 (indexed), 15, 16, 24 or 32; 0 in text mode */
+	uint32_t dac_width;			/**< @brief Bits per channel of the palette */
+	uint32_t size;				/**< @brief Bytes of framebuffer after FB_SHM_PIXELS */
+	uint8_t palette[256][3];	/**< @brief Red, green and blue of each index, dac_width bits each */
+} fb_shm_header_t;
+/** @} end of Header */
+
+/** @} end of fb_shm */
+
+#endif /* FB_SHM_H_ */
@@ -0,0 +1,255 @@
+/*
+ * fbview.c
+ *
+ * Viewer for the framebuffer segment of host builds: prints its mode, dumps
+ * frames as PPM images or shows them in a 24 bit color terminal. It only
+ * reads the segment, so it does not slow the game down.
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fb_shm.h"
+
+#define POLL_US			2000	/**< @brief Wait between checks of the segment */
+#define SHOW_COLUMNS	160		/**< @brief Default width of the terminal view, in chars */
+
+static volatile sig_atomic_t stop = 0;	/**< @brief An interrupt was received */
+
+static void on_signal(int signal) {
+	stop = 1;
+}
+
+static void nap() {
+	struct timespec wait = { 0, POLL_US * 1000L };
+
+	nanosleep(&wait, NULL);
+}
+
+/**
+ * @brief Map a segment read only.
+ *
+ * @return the segment, NULL on error
+ */
+static const unsigned char *segment_map(const char *name) {
+	const unsigned char *segment;
+	struct stat info;
+	int fd;
+
+	if((fd = shm_open(name, O_RDONLY, 0)) == -1) {
+		return NULL;
+	}
+	if((fstat(fd, &info) == -1) || (info.st_size < FB_SHM_PIXELS)) {
+		close(fd);
+		return NULL;
+	}
+	segment = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(segment == MAP_FAILED) {
+		return NULL;
+	}
+
+	if((__atomic_load_n(&((const fb_shm_header_t *)segment)->magic, __ATOMIC_ACQUIRE) != FB_SHM_MAGIC) ||
+			(((const fb_shm_header_t *)segment)->version != FB_SHM_VERSION)) {
+		return NULL;
+	}
+
+	return segment;
+}
+
+/**
+ * @brief Copy the header and the visible part of the framebuffer, consistently.
+ *
+ * @param pixels where to copy the framebuffer, the size in the header, or NULL for the header only
+ */
+static void snapshot(const unsigned char *segment, fb_shm_header_t *header, unsigned char *pixels) {
+	const fb_shm_header_t *shared = (const fb_shm_header_t *)segment;
+	uint32_t before, after;
+
+	for(;;) {
+		before = __atomic_load_n(&shared->sequence, __ATOMIC_ACQUIRE);
+		if(before & 1) {
+			nap();
+			continue;
+		}
+
+		memcpy(header, shared, sizeof(fb_shm_header_t));
+		if((pixels != NULL) && (header->pitch * header->height <= header->size)) {
+			memcpy(pixels, segment + FB_SHM_PIXELS, header->pitch * header->height);
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		after = __atomic_load_n(&shared->sequence, __ATOMIC_RELAXED);
+		if(before == after) {
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Get a pixel as 8 bit red, green and blue, in the layouts of the emulated adapter.
+ */
+static void pixel_rgb(const fb_shm_header_t *header, const unsigned char *pixels, unsigned int x, unsigned int y, unsigned char rgb[3]) {
+	const unsigned char *p = pixels + y * header->pitch + x * ((header->bits_per_pixel + 7) / 8);
+	unsigned int value, c;
+
+	switch(header->bits_per_pixel) {
+	case 8:
+		for(c = 0; c < 3; c++) {
+			value = header->palette[*p][c];
+			rgb[c] = (header->dac_width == 8) ? value : (value << 2) | (value >> 4);
+		}
+		break;
+	case 15:
+		value = p[0] | (p[1] << 8);
+		rgb[0] = ((value >> 10) & 0x1F) * 255 / 31;
+		rgb[1] = ((value >> 5) & 0x1F) * 255 / 31;
+		rgb[2] = (value & 0x1F) * 255 / 31;
+		break;
+	case 16:
+		value = p[0] | (p[1] << 8);
+		rgb[0] = ((value >> 11) & 0x1F) * 255 / 31;
+		rgb[1] = ((value >> 5) & 0x3F) * 255 / 63;
+		rgb[2] = (value & 0x1F) * 255 / 31;
+		break;
+	default:
+		rgb[0] = p[2];
+		rgb[1] = p[1];
+		rgb[2] = p[0];
+		break;
+	}
+}
+
+static int dump(const fb_shm_header_t *header, const unsigned char *pixels, const char *path) {
+	unsigned char rgb[3];
+	unsigned int x, y;
+	FILE *file;
+
+	if((file = fopen(path, "wb")) == NULL) {
+		return -1;
+	}
+
+	fprintf(file, "P6\n%u %u\n255\n", header->width, header->height);
+	for(y = 0; y < header->height; y++) {
+		for(x = 0; x < header->width; x++) {
+			pixel_rgb(header, pixels, x, y, rgb);
+			fwrite(rgb, 1, 3, file);
+		}
+	}
+
+	return (fclose(file) == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Draw a frame in the terminal, two rows of pixels per line of chars.
+ */
+static void show(const fb_shm_header_t *header, const unsigned char *pixels, unsigned int columns) {
+	unsigned int rows = (header->height * columns / header->width + 1) / 2;
+	unsigned char top[3], bottom[3];
+	unsigned int col, row, x;
+
+	printf("\x1b[H");
+	for(row = 0; row < rows; row++) {
+		for(col = 0; col < columns; col++) {
+			x = col * header->width / columns;
+			pixel_rgb(header, pixels, x, (row * 2) * header->height / (rows * 2), top);
+			pixel_rgb(header, pixels, x, (row * 2 + 1) * header->height / (rows * 2), bottom);
+			printf("\x1b[38;2;%u;%u;%um\x1b[48;2;%u;%u;%um\xe2\x96\x80", top[0], top[1], top[2], bottom[0], bottom[1], bottom[2]);
+		}
+		printf("\x1b[0m\n");
+	}
+	printf("frame %u, %ux%u, %u bits per pixel\x1b[K\n", header->frame, header->width, header->height, header->bits_per_pixel);
+	fflush(stdout);
+}
+
+static void print_usage(char *argv[]) {
+	printf("Usage: one of the following:\n"
+		"\t %s <segment> (print the mode and the frame count)\n"
+		"\t %s <segment> dump <file.ppm> [frame] (save the frame shown, or the first at or after frame)\n"
+		"\t %s <segment> show [columns] (show every frame in the terminal, until interrupted)\n",
+		argv[0], argv[0], argv[0]);
+}
+
+int main(int argc, char *argv[]) {
+	const unsigned char *segment;
+	fb_shm_header_t header;
+	unsigned char *pixels;
+	unsigned long frame = 0;
+	unsigned int columns = SHOW_COLUMNS;
+	uint32_t shown = 0;
+
+	if((argc < 2) || ((argc > 2) && strcmp(argv[2], "dump") && strcmp(argv[2], "show"))) {
+		print_usage(argv);
+		return 1;
+	}
+
+	if((segment = segment_map(argv[1])) == NULL) {
+		fprintf(stderr, "%s: %s is not a framebuffer segment\n", argv[0], argv[1]);
+		return 1;
+	}
+
+	snapshot(segment, &header, NULL);
+	if(argc == 2) {
+		printf("frame %u, sequence %u, %ux%u, pitch %u, %u bits per pixel, %u bit palette\n", header.frame,
+				header.sequence, header.width, header.height, header.pitch, header.bits_per_pixel, header.dac_width);
+		return 0;
+	}
+
+	if((pixels = malloc(header.size)) == NULL) {
+		return 1;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	if(strcmp(argv[2], "dump") == 0) {
+		if((argc < 4) || (argc > 5)) {
+			print_usage(argv);
+			return 1;
+		}
+		if(argc == 5) {
+			frame = strtoul(argv[4], NULL, 10);
+		}
+		for(snapshot(segment, &header, pixels); !stop && (header.frame < frame); snapshot(segment, &header, pixels)) {
+			nap();
+		}
+		if(stop || (header.bits_per_pixel == 0)) {
+			fprintf(stderr, "%s: no frame to dump\n", argv[0]);
+			return 1;
+		}
+		if(dump(&header, pixels, argv[3]) != 0) {
+			perror(argv[3]);
+			return 1;
+		}
+		printf("frame %u saved to %s\n", header.frame, argv[3]);
+		return 0;
+	}
+
+	if(argc > 3) {
+		columns = strtoul(argv[3], NULL, 10);
+	}
+	if(columns == 0) {
+		print_usage(argv);
+		return 1;
+	}
+
+	printf("\x1b[2J");
+	while(!stop) {
+		snapshot(segment, &header, pixels);
+		/* palette changes bump the sequence without a new frame */
+		if((header.sequence != shown) && (header.bits_per_pixel != 0) && (header.width >= columns)) {
+			show(&header, pixels, columns);
+			shown = header.sequence;
+		}
+		nap();
+	}
+	printf("\x1b[0m\n");
+
+	return 0;
+}
@@ -0,0 +1,181 @@
+#ifndef HOST_H_
+#define HOST_H_
+
+#include "libraries.h"
+
+/** @defgroup host host
+ * @{
+ *
+ * Linux host platform: the Minix kernel calls the game makes, implemented
+ * over emulated devices (i8254, i8042, RTC, VBE and the VGA DAC), a RAM
+ * framebuffer and a synthetic interrupt notification loop.
+ *
+ * The game sources are built unchanged against host/include, so the choice
+ * of platform is made when linking and no call goes through a pointer.
+ *
+ * Environment variables:
+ *  - HOST_TICKS: timer ticks before ESC is pressed, repeated until the game exits (default 600)
+ *  - HOST_REALTIME: if set, timer ticks and tickdelay() take real time
+ *  - HOST_EPOCH: seconds since 1970 the RTC starts at (default: the current time)
+ *  - HOST_32BPP: if set, the 24 bit VBE modes have 32 bits per pixel
+ *  - HOST_FB: name of a shared memory segment to present to, for host/fbview (see fb_shm.h)
+ */
+
+#define HOST_HZ				60				/**< @brief Minix system clock ticks per second, for tickdelay() */
+#define HOST_TICKS			600				/**< @brief Default timer ticks before the synthetic ESC */
+#define HOST_ESC_PERIOD		60				/**< @brief Timer ticks between synthetic ESC presses */
+#define HOST_VRAM_BASE		0xE0000000		/**< @brief Physical address of the emulated framebuffer */
+#define HOST_VRAM_SIZE		(16 << 20)		/**< @brief Bytes of the emulated framebuffer */
+#define HOST_LM_BASE		0x10000			/**< @brief Physical address of the emulated low memory blocks */
+#define HOST_LM_SIZE		0x10000			/**< @brief Bytes of emulated low memory */
+
+/** @name Screen */
+/**@{
+ *
+ * Mode set on the emulated adapter
+ */
+typedef struct {
+	unsigned char *pixels;		/**< @brief first pixel of the framebuffer */
+	unsigned int width;			/**< @brief horizontal resolution */
+	unsigned int height;		/**< @brief vertical resolution */
+	unsigned int pitch;			/**< @brief bytes per row */
+	unsigned int bits_per_pixel;	/**< @brief bits per pixel, 0 in text mode */
+	const unsigned char (*dac)[3];	/**< @brief the 256 DAC entries, 6 or 8 bits per channel */
+	unsigned int dac_width;		/**< @brief bits per channel of the DAC */
+} host_screen_t;
+/** @} end of Screen */
+
+/**
+ * @brief Write to an i8254 port: 0x40 to 0x43, or the speaker control port 0x61.
+ */
+void host_i8254_write(int port, unsigned long value);
+/**
+ * @brief Read an i8254 port.
+ */
+unsigned long host_i8254_read(int port);
+/**
+ * @brief Get the frequency a timer was programmed to.
+ *
+ * @param timer 0, 1 or 2
+ *
+ * @return frequency in Hz, about 18.2 until the timer is programmed
+ */
+double host_i8254_frequency(unsigned int timer);
+
+/**
+ * @brief Write to an i8042 port: 0x60 or 0x64.
+ */
+void host_i8042_write(int port, unsigned long value);
+/**
+ * @brief Read an i8042 port: the status register or the next byte of the output queue.
+ */
+unsigned long host_i8042_read(int port);
+/**
+ * @brief Get the interrupt the i8042 raises for the byte at the head of its output queue.
+ *
+ * Each byte raises its interrupt once.
+ *
+ * @return KBC_IRQ or MOUSE_IRQ, -1 if no byte is waiting or it was already announced
+ */
+int host_i8042_irq();
+/**
+ * @brief Queue a scancode, as if a key was pressed or released.
+ *
+ * @return 0 if success, -1 if the queue is full
+ */
+int host_i8042_key(unsigned char scancode);
+/**
+ * @brief Queue a mouse packet, if the mouse is streaming.
+ *
+ * @param dx horizontal displacement, -255 to 255
+ * @param dy vertical displacement, -255 to 255, positive upwards
+ * @param buttons bit 0 left, bit 1 right, bit 2 middle
+ *
+ * @return 0 if success, -1 if the mouse is not streaming or the queue is full
+ */
+int host_i8042_mouse(int dx, int dy, unsigned char buttons);
+
+/**
+ * @brief Write to an RTC port: 0x70 or 0x71.
+ */
+void host_rtc_write(int port, unsigned long value);
+/**
+ * @brief Read an RTC port.
+ */
+unsigned long host_rtc_read(int port);
+
+/**
+ * @brief Run a video BIOS call: VBE functions 0x01, 0x02, 0x08 and 0x09, and setting the text mode.
+ *
+ * @return 0 if the call exists, -1 otherwise
+ */
+int host_vbe_int10(struct reg86u *reg86p);
+/**
+ * @brief Write to a VGA DAC port: 0x3C7, 0x3C8 or 0x3C9.
+ */
+void host_vbe_write(int port, unsigned long value);
+/**
+ * @brief Read a VGA DAC port.
+ */
+unsigned long host_vbe_read(int port);
+/**
+ * @brief Map a range of the emulated framebuffer.
+ *
+ * @return the range, NULL if it is outside the framebuffer
+ */
+void *host_vbe_map(phys_bytes base, size_t len);
+/**
+ * @brief Get the mode set on the emulated adapter.
+ */
+const host_screen_t *host_vbe_screen();
+
+/**
+ * @brief Get the emulated framebuffer, HOST_VRAM_SIZE bytes.
+ *
+ * It is in the shared memory segment named by HOST_FB if there is one (see fb_shm.h).
+ *
+ * @return the framebuffer, NULL if it could not be allocated
+ */
+unsigned char *host_fb_vram();
+/**
+ * @brief Publish a mode set, or a change of the DAC width, to the framebuffer segment.
+ */
+void host_fb_mode(const host_screen_t *screen);
+/**
+ * @brief Publish DAC entries to the framebuffer segment.
+ *
+ * @param first index of the first entry
+ * @param count number of entries
+ * @param rgb all the DAC entries
+ */
+void host_fb_palette(unsigned int first, unsigned int count, const unsigned char rgb[][3]);
+
+/**
+ * @brief Get a range of emulated low memory, where BIOS calls find their tables.
+ *
+ * @return the range, NULL if it is outside low memory
+ */
+void *host_lm_virtual(phys_bytes phys, size_t len);
+
+/**
+ * @brief Notify the hooks subscribed to an interrupt line.
+ *
+ * @return bits of the notified hooks, for NOTIFY_ARG
+ */
+unsigned long host_irq_raise(int irq);
+/**
+ * @brief Get the number of timer 0 interrupts so far.
+ */
+unsigned long host_ticks();
+/**
+ * @brief Get the time of the emulated clock, which advances with timer 0.
+ */
+time_t host_time();
+/**
+ * @brief Whether timer ticks and delays take real time.
+ */
+int host_realtime();
+
+/** @} end of host */
+
+#endif /* HOST_H_ */
@@ -0,0 +1,172 @@
+/*
+ * i8042.c
+ *
+ * Emulated i8042 keyboard controller, with a keyboard and a PS/2 mouse.
+ */
+
+#include "host.h"
+#include "i8042.h"
+#include "keyboard.h"
+
+#define QUEUE_SIZE			256		/**< @brief Bytes the output queue holds */
+#define AUX_DATA			BIT(5)	/**< @brief Status bit: the output byte comes from the mouse */
+#define CMD_READ_COMMAND	0x20	/**< @brief Controller command: read the command byte */
+#define CMD_WRITE_COMMAND	0x60	/**< @brief Controller command: write the command byte */
+#define ACK					0xFA	/**< @brief Device reply to a command byte */
+#define MOUSE_BAT_OK		0xAA	/**< @brief Mouse reply after a reset */
+#define MOUSE_DEVICE_ID		0x00	/**< @brief Mouse device id, a standard PS/2 mouse */
+
+/** @name Output byte */
+/**@{
+ *
+ * Byte waiting in the output buffer
+ */
+typedef struct {
+	unsigned char data;		/**< @brief the byte */
+	unsigned char aux;		/**< @brief it comes from the mouse */
+} OUTPUT;
+/** @} end of Output byte */
+
+static OUTPUT queue[QUEUE_SIZE];	/**< @brief Bytes for the output buffer, as a ring */
+static unsigned int head = 0;		/**< @brief Index of the byte in the output buffer */
+static unsigned int count = 0;		/**< @brief Bytes in the queue */
+static int announced = 0;			/**< @brief The interrupt of the head byte was raised */
+static unsigned char last = 0;		/**< @brief Last byte read, read again from an empty buffer */
+
+static unsigned char command = 0x47;	/**< @brief Controller command byte: both interrupts enabled */
+static unsigned char pending = 0;		/**< @brief Controller command waiting for its data byte, 0 if none */
+static unsigned char keyboard_pending = 0;	/**< @brief Keyboard command waiting for its data byte, 0 if none */
+static int streaming = 0;				/**< @brief The mouse sends packets */
+
+static int push(unsigned char data, unsigned char aux) {
+	if(count == QUEUE_SIZE) {
+		return -1;
+	}
+	queue[(head + count) % QUEUE_SIZE].data = data;
+	queue[(head + count) % QUEUE_SIZE].aux = aux;
+	count++;
+	return 0;
+}
+
+/**
+ * @brief Reply of the mouse to a byte written with WRITE_MOUSE_BYTE.
+ */
+static void mouse_command(unsigned char cmd) {
+	push(ACK, 1);
+
+	switch(cmd) {
+	case MOUSE_ENABLE_STREAM:
+		streaming = 1;
+		break;
+	case MOUSE_DISABLE_STREAM:
+		streaming = 0;
+		break;
+	case MOUSE_RESET:
+		streaming = 0;
+		push(MOUSE_BAT_OK, 1);
+		push(MOUSE_DEVICE_ID, 1);
+		break;
+	case MOUSE_STATUS_REQUEST:
+		/* stream mode, reporting if enabled, scaling 1:1; resolution 4 counts/mm, 100 samples/s */
+		push(streaming ? 0x20 : 0x00, 1);
+		push(0x02, 1);
+		push(100, 1);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Reply of the keyboard to a byte written to the input buffer.
+ */
+static void keyboard_command(unsigned char cmd) {
+	if(keyboard_pending) {
+		/* the data byte of a command, e.g. the LEDs after KBD_SWITCH_LEDS */
+		keyboard_pending = 0;
+		push(ACK, 0);
+		return;
+	}
+
+	push(ACK, 0);
+	if(cmd == KBD_SWITCH_LEDS) {
+		keyboard_pending = cmd;
+	}
+}
+
+void host_i8042_write(int port, unsigned long value) {
+	value &= 0xFF;
+
+	if(port == KBC_CMD_REG) {
+		if(value == CMD_READ_COMMAND) {
+			push(command, 0);
+		}
+		else if((value == CMD_WRITE_COMMAND) || (value == WRITE_MOUSE_BYTE)) {
+			pending = value;
+		}
+		return;
+	}
+
+	switch(pending) {
+	case CMD_WRITE_COMMAND:
+		command = value;
+		break;
+	case WRITE_MOUSE_BYTE:
+		mouse_command(value);
+		break;
+	default:
+		keyboard_command(value);
+		break;
+	}
+	pending = 0;
+}
+
+unsigned long host_i8042_read(int port) {
+	if(port == STAT_REG) {
+		/* the input buffer is always empty: commands are taken as they are written */
+		if(count == 0) {
+			return 0;
+		}
+		return OBF | (queue[head].aux ? AUX_DATA : 0);
+	}
+
+	if(count > 0) {
+		last = queue[head].data;
+		head = (head + 1) % QUEUE_SIZE;
+		count--;
+		announced = 0;
+	}
+	return last;
+}
+
+int host_i8042_irq() {
+	if((count == 0) || announced) {
+		return -1;
+	}
+	announced = 1;
+	return queue[head].aux ? MOUSE_IRQ : KBC_IRQ;
+}
+
+int host_i8042_key(unsigned char scancode) {
+	return push(scancode, 0);
+}
+
+int host_i8042_mouse(int dx, int dy, unsigned char buttons) {
+	unsigned char first = BIT(3) | (buttons & 0x07);
+
+	if(!streaming || (count + 3 > QUEUE_SIZE)) {
+		return -1;
+	}
+
+	if(dx < 0) {
+		first |= BIT(4);
+	}
+	if(dy < 0) {
+		first |= BIT(5);
+	}
+
+	push(first, 1);
+	push(dx & 0xFF, 1);
+	push(dy & 0xFF, 1);
+	return 0;
+}
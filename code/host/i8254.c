@@ -0,0 +1,88 @@
+/*
+ * i8254.c
+ *
+ * Emulated i8254 timers and speaker control port.
+ */
+
+#include "host.h"
+#include "i8254.h"
+
+/** @name Counter */
+/**@{
+ *
+ * State of one of the three counters
+ */
+typedef struct {
+	unsigned long divisor;		/**< @brief initial count, 0 stands for 65536 */
+	unsigned char access;		/**< @brief TIMER_LSB, TIMER_MSB or TIMER_LSB_MSB */
+	unsigned char high_next;	/**< @brief the next TIMER_LSB_MSB write is the MSB */
+	unsigned char control;		/**< @brief last control word */
+} COUNTER;
+/** @} end of Counter */
+
+static COUNTER counters[3];			/**< @brief Timers 0, 1 and 2 */
+static unsigned long speaker = 0;	/**< @brief Speaker control register */
+
+void host_i8254_write(int port, unsigned long value) {
+	COUNTER *counter;
+	unsigned int select;
+
+	if(port == SPEAKER_CTRL) {
+		speaker = value & 0xFF;
+		return;
+	}
+
+	if(port == TIMER_CTRL) {
+		select = (value >> 6) & 0x03;
+		/* read back and counter latch commands change nothing here */
+		if((select == 3) || ((value & TIMER_LSB_MSB) == 0)) {
+			return;
+		}
+		counter = &counters[select];
+		counter->control = value;
+		counter->access = value & TIMER_LSB_MSB;
+		counter->high_next = 0;
+		return;
+	}
+
+	counter = &counters[port - TIMER_0];
+	switch(counter->access) {
+	case TIMER_LSB:
+		counter->divisor = value & 0xFF;
+		break;
+	case TIMER_MSB:
+		counter->divisor = (value & 0xFF) << 8;
+		break;
+	default:
+		if(counter->high_next) {
+			counter->divisor = (counter->divisor & 0xFF) | ((value & 0xFF) << 8);
+		}
+		else {
+			counter->divisor = value & 0xFF;
+		}
+		counter->high_next = !counter->high_next;
+		break;
+	}
+}
+
+unsigned long host_i8254_read(int port) {
+	if(port == SPEAKER_CTRL) {
+		return speaker;
+	}
+	if(port == TIMER_CTRL) {
+		return 0xFF;
+	}
+	/* the count is not emulated, only the rate of timer 0 interrupts */
+	return 0;
+}
+
+double host_i8254_frequency(unsigned int timer) {
+	unsigned long divisor;
+
+	if(timer > 2) {
+		return 0;
+	}
+
+	divisor = counters[timer].divisor ? counters[timer].divisor : 65536;
+	return (double)TIMER_FREQ / divisor;
+}
@@ -0,0 +1,27 @@
+/*
+ * machine/int86.h
+ *
+ * Host stand-in for the BIOS call registers, laid out as on Minix:
+ * the byte registers overlap the word ones, low byte first.
+ */
+
+#ifndef _HOST_MACHINE_INT86_H
+#define _HOST_MACHINE_INT86_H
+
+#include <stdint.h>
+
+struct reg86u {
+	union {
+		struct {
+			uint16_t ax, bx, cx, dx;
+			uint16_t si, di, bp, es, ds, fs, gs, flags;
+		} w;
+		struct {
+			uint8_t al, ah, bl, bh, cl, ch, dl, dh;
+			uint8_t others[16];
+			uint8_t intno;
+		} b;
+	} u;
+};
+
+#endif /* _HOST_MACHINE_INT86_H */
@@ -0,0 +1,25 @@
+/*
+ * minix/com.h
+ *
+ * Host stand-in for the Minix constants used by the game.
+ */
+
+#ifndef _HOST_MINIX_COM_H
+#define _HOST_MINIX_COM_H
+
+#define OK					0		/**< @brief Kernel call succeeded */
+#define ANY					0x7ace	/**< @brief Receive from any endpoint */
+#define SELF				0x8ace	/**< @brief The calling process */
+#define HARDWARE			(-2)	/**< @brief Source of interrupt notifications */
+
+#define SYS_PRIV_ADD_MEM	2		/**< @brief sys_privctl() request: allow mapping a memory range */
+
+#define IRQ_REENABLE		0x001	/**< @brief Reenable the interrupt after each notification */
+#define IRQ_EXCLUSIVE		0x002	/**< @brief Only this hook receives the interrupt */
+
+#define NOTIFY_STATUS		1		/**< @brief driver_receive() status of a notification */
+
+#define _ENDPOINT_P(e)		(e)		/**< @brief Process slot of an endpoint */
+#define is_ipc_notify(s)	((s) == NOTIFY_STATUS)	/**< @brief Whether a message is a notification */
+
+#endif /* _HOST_MINIX_COM_H */
@@ -0,0 +1,14 @@
+/*
+ * minix/drivers.h
+ *
+ * Host stand-in for the Minix driver headers.
+ */
+
+#ifndef _HOST_MINIX_DRIVERS_H
+#define _HOST_MINIX_DRIVERS_H
+
+#include <unistd.h>
+#include <minix/syslib.h>
+#include <minix/sysutil.h>
+
+#endif /* _HOST_MINIX_DRIVERS_H */
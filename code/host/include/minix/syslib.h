@@ -0,0 +1,48 @@
+/*
+ * minix/syslib.h
+ *
+ * Host stand-in for the Minix kernel calls used by the game.
+ * They are implemented by host/kernel.c and host/ipc.c.
+ */
+
+#ifndef _HOST_MINIX_SYSLIB_H
+#define _HOST_MINIX_SYSLIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <minix/com.h>
+
+typedef uint32_t phys_bytes;	/**< @brief physical address */
+typedef unsigned long vir_bytes;	/**< @brief virtual address */
+typedef int endpoint_t;		/**< @brief process endpoint */
+
+/** @brief Physical memory range, for SYS_PRIV_ADD_MEM */
+struct mem_range {
+	phys_bytes mr_base;		/**< @brief first address */
+	phys_bytes mr_limit;	/**< @brief last address */
+};
+
+/** @brief IPC message; only notifications are ever received */
+typedef struct {
+	endpoint_t m_source;	/**< @brief sender */
+	int m_type;				/**< @brief message type */
+	unsigned long m2_l1;	/**< @brief notification argument */
+} message;
+
+#define NOTIFY_ARG	m2_l1	/**< @brief Bits of the hooks whose interrupts are notified */
+
+struct reg86u;
+
+int sys_inb(int port, unsigned long *value);
+int sys_outb(int port, unsigned long value);
+int sys_int86(struct reg86u *reg86p);
+int sys_privctl(endpoint_t proc_ep, int req, void *p);
+int sys_irqsetpolicy(int irq_vec, int policy, int *irq_hook_id);
+int sys_irqrmpolicy(int *irq_hook_id);
+int sys_irqenable(int *irq_hook_id);
+int sys_irqdisable(int *irq_hook_id);
+void *vm_map_phys(endpoint_t who, void *physaddr, size_t len);
+int vm_unmap_phys(endpoint_t who, void *vaddr, size_t len);
+int driver_receive(endpoint_t src, message *m_ptr, int *status_ptr);
+
+#endif /* _HOST_MINIX_SYSLIB_H */
@@ -0,0 +1,14 @@
+/*
+ * minix/sysutil.h
+ *
+ * Host stand-in for the Minix system utilities used by the game.
+ */
+
+#ifndef _HOST_MINIX_SYSUTIL_H
+#define _HOST_MINIX_SYSUTIL_H
+
+void sef_startup(void);
+int tickdelay(long ticks);
+long micros_to_ticks(long micros);
+
+#endif /* _HOST_MINIX_SYSUTIL_H */
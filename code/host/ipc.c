@@ -0,0 +1,104 @@
+/*
+ * ipc.c
+ *
+ * Synthetic notification loop: driver_receive() delivers the interrupts of
+ * the emulated devices, advancing the emulated clock one timer 0 period at a
+ * time, and plays the synthetic input.
+ */
+
+#include "host.h"
+#include "i8254.h"
+#include "i8042.h"
+
+#define MAKECODE_ESC	0x01	/**< @brief Make code of the ESC key */
+#define BREAKCODE_ESC	0x81	/**< @brief Break code of the ESC key */
+
+static unsigned long ticks = 0;			/**< @brief Timer 0 interrupts so far */
+static double elapsed = 0;				/**< @brief Seconds of emulated time so far */
+static time_t epoch = 0;				/**< @brief Time of the emulated clock at start, 0 until read */
+static unsigned long input_ticks = 0;	/**< @brief Ticks before the synthetic ESC, 0 until read */
+static int realtime = -1;				/**< @brief Ticks take real time, -1 until read */
+
+static unsigned long env(const char *name, unsigned long fallback) {
+	const char *value = getenv(name);
+
+	return (value != NULL) ? strtoul(value, NULL, 0) : fallback;
+}
+
+int host_realtime() {
+	if(realtime == -1) {
+		realtime = (getenv("HOST_REALTIME") != NULL);
+	}
+	return realtime;
+}
+
+unsigned long host_ticks() {
+	return ticks;
+}
+
+time_t host_time() {
+	if(epoch == 0) {
+		epoch = env("HOST_EPOCH", time(NULL));
+	}
+	return epoch + (time_t)elapsed;
+}
+
+/**
+ * @brief Synthetic input for a tick: ESC, every HOST_ESC_PERIOD ticks after HOST_TICKS.
+ */
+static void input(unsigned long tick) {
+	if(input_ticks == 0) {
+		input_ticks = env("HOST_TICKS", HOST_TICKS);
+	}
+
+	if((tick >= input_ticks) && ((tick - input_ticks) % HOST_ESC_PERIOD == 0)) {
+		host_i8042_key(MAKECODE_ESC);
+		host_i8042_key(BREAKCODE_ESC);
+	}
+}
+
+/**
+ * @brief Advance the emulated clock by one period of timer 0.
+ */
+static void tick() {
+	double period = 1.0 / host_i8254_frequency(0);
+	struct timespec wait;
+
+	ticks++;
+	elapsed += period;
+
+	if(host_realtime()) {
+		wait.tv_sec = 0;
+		wait.tv_nsec = period * 1e9;
+		nanosleep(&wait, NULL);
+	}
+
+	input(ticks);
+}
+
+int driver_receive(endpoint_t src, message *m_ptr, int *status_ptr) {
+	unsigned long bits = 0;
+	int irq;
+
+	if(host_irq_raise(TIMER_IRQ) == 0) {
+		/* nothing would ever wake the process */
+		return -1;
+	}
+
+	/* a byte in the i8042 output buffer interrupts before the next tick */
+	while(bits == 0) {
+		if((irq = host_i8042_irq()) != -1) {
+			bits = host_irq_raise(irq);
+			continue;
+		}
+		tick();
+		bits = host_irq_raise(TIMER_IRQ);
+	}
+
+	m_ptr->m_source = HARDWARE;
+	m_ptr->m_type = 0;
+	m_ptr->NOTIFY_ARG = bits;
+	*status_ptr = NOTIFY_STATUS;
+
+	return 0;
+}
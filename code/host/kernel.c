@@ -0,0 +1,149 @@
+/*
+ * kernel.c
+ *
+ * Minix kernel calls on the host: port I/O, interrupt policies, memory
+ * mapping and BIOS calls, dispatched to the emulated devices.
+ */
+
+#include "host.h"
+#include "i8254.h"
+#include "i8042.h"
+#include "rtc.h"
+
+#define HOOKS	16	/**< @brief Interrupt policies that can be set at once */
+
+/** @name Hook */
+/**@{
+ *
+ * Interrupt policy set with sys_irqsetpolicy()
+ */
+typedef struct {
+	int used;				/**< @brief the policy is set */
+	int irq;				/**< @brief interrupt line */
+	unsigned long bit;		/**< @brief NOTIFY_ARG bit, from the hook id the caller chose */
+} HOOK;
+/** @} end of Hook */
+
+static HOOK hooks[HOOKS];	/**< @brief Interrupt policies, indexed by the kernel's hook id */
+
+int sys_outb(int port, unsigned long value) {
+	if(((port >= TIMER_0) && (port <= TIMER_CTRL)) || (port == SPEAKER_CTRL)) {
+		host_i8254_write(port, value);
+	}
+	else if((port == IN_BUF) || (port == KBC_CMD_REG)) {
+		host_i8042_write(port, value);
+	}
+	else if((port == RTC_ADDR_REG) || (port == RTC_DATA_REG)) {
+		host_rtc_write(port, value);
+	}
+	else if((port >= 0x3C7) && (port <= 0x3C9)) {
+		host_vbe_write(port, value);
+	}
+	return OK;
+}
+
+int sys_inb(int port, unsigned long *value) {
+	if(((port >= TIMER_0) && (port <= TIMER_CTRL)) || (port == SPEAKER_CTRL)) {
+		*value = host_i8254_read(port);
+	}
+	else if((port == OUT_BUF) || (port == STAT_REG)) {
+		*value = host_i8042_read(port);
+	}
+	else if((port == RTC_ADDR_REG) || (port == RTC_DATA_REG)) {
+		*value = host_rtc_read(port);
+	}
+	else if((port >= 0x3C7) && (port <= 0x3C9)) {
+		*value = host_vbe_read(port);
+	}
+	else {
+		/* nothing on the bus */
+		*value = 0xFF;
+	}
+	return OK;
+}
+
+int sys_int86(struct reg86u *reg86p) {
+	return (host_vbe_int10(reg86p) == 0) ? OK : -1;
+}
+
+int sys_privctl(endpoint_t proc_ep, int req, void *p) {
+	return OK;
+}
+
+void *vm_map_phys(endpoint_t who, void *physaddr, size_t len) {
+	void *virtual = host_vbe_map((phys_bytes)(unsigned long)physaddr, len);
+
+	return (virtual != NULL) ? virtual : (void *)-1;
+}
+
+int vm_unmap_phys(endpoint_t who, void *vaddr, size_t len) {
+	return OK;
+}
+
+int sys_irqsetpolicy(int irq_vec, int policy, int *irq_hook_id) {
+	unsigned int i;
+
+	if((*irq_hook_id < 0) || (*irq_hook_id >= (int)(sizeof(unsigned long) * 8))) {
+		return -1;
+	}
+
+	for(i = 0; i < HOOKS; i++) {
+		if(!hooks[i].used) {
+			hooks[i].used = 1;
+			hooks[i].irq = irq_vec;
+			hooks[i].bit = 1UL << *irq_hook_id;
+			/* as on Minix, the caller gets back the kernel's id of the hook */
+			*irq_hook_id = i;
+			return OK;
+		}
+	}
+
+	return -1;
+}
+
+int sys_irqrmpolicy(int *irq_hook_id) {
+	if((*irq_hook_id < 0) || (*irq_hook_id >= HOOKS) || !hooks[*irq_hook_id].used) {
+		return -1;
+	}
+	hooks[*irq_hook_id].used = 0;
+	return OK;
+}
+
+int sys_irqenable(int *irq_hook_id) {
+	return OK;
+}
+
+int sys_irqdisable(int *irq_hook_id) {
+	return OK;
+}
+
+unsigned long host_irq_raise(int irq) {
+	unsigned long bits = 0;
+	unsigned int i;
+
+	for(i = 0; i < HOOKS; i++) {
+		if(hooks[i].used && (hooks[i].irq == irq)) {
+			bits |= hooks[i].bit;
+		}
+	}
+
+	return bits;
+}
+
+void sef_startup(void) {
+}
+
+int tickdelay(long ticks) {
+	struct timespec wait;
+
+	if(host_realtime() && (ticks > 0)) {
+		wait.tv_sec = ticks / HOST_HZ;
+		wait.tv_nsec = (ticks % HOST_HZ) * (1000000000L / HOST_HZ);
+		nanosleep(&wait, NULL);
+	}
+	return OK;
+}
+
+long micros_to_ticks(long micros) {
+	return (micros * HOST_HZ + 999999) / 1000000;
+}
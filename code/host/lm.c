@@ -0,0 +1,50 @@
+/*
+ * lm.c
+ *
+ * Emulated low memory, for the tables BIOS calls read and write.
+ */
+
+#include "host.h"
+#include "lmlib.h"
+
+static unsigned char memory[HOST_LM_SIZE];	/**< @brief Low memory, at physical address HOST_LM_BASE */
+static unsigned long used = 0;				/**< @brief Bytes handed out since all blocks were last free */
+static unsigned int blocks = 0;				/**< @brief Blocks allocated and not freed */
+
+int lm_init(void) {
+	return 0;
+}
+
+void *lm_alloc(unsigned long size, mmap_t *map) {
+	/* the space is reused once every block is freed, or as the last block is freed */
+	size = (size + 15) & ~15UL;
+	if(used + size > HOST_LM_SIZE) {
+		return NULL;
+	}
+
+	map->phys = HOST_LM_BASE + used;
+	map->virtual = memory + used;
+	map->size = size;
+	used += size;
+	blocks++;
+
+	return map->virtual;
+}
+
+void lm_free(mmap_t *map) {
+	/* the last block handed out gives its space back, so short lived blocks can come and go past a long lived one */
+	if((map->virtual != NULL) && ((unsigned char *)map->virtual + map->size == memory + used)) {
+		used -= map->size;
+	}
+	if((blocks > 0) && (--blocks == 0)) {
+		used = 0;
+	}
+	map->virtual = NULL;
+}
+
+void *host_lm_virtual(phys_bytes phys, size_t len) {
+	if((phys < HOST_LM_BASE) || (phys - HOST_LM_BASE + len > HOST_LM_SIZE)) {
+		return NULL;
+	}
+	return memory + (phys - HOST_LM_BASE);
+}
@@ -0,0 +1,69 @@
+/*
+ * rtc.c
+ *
+ * Emulated RTC, in BCD and 24 hour format, driven by the emulated clock.
+ */
+
+#include "host.h"
+#include "rtc.h"
+
+#define REG_SECONDS		0	/**< @brief Seconds register */
+#define REG_MINUTES		2	/**< @brief Minutes register */
+#define REG_HOURS		4	/**< @brief Hours register */
+#define REG_WEEK_DAY	6	/**< @brief Day of the week register, 1 is Sunday */
+#define REG_MONTH_DAY	7	/**< @brief Day of the month register */
+#define REG_MONTH		8	/**< @brief Month register */
+#define REG_YEAR		9	/**< @brief Year register, two digits */
+#define REG_B_24H		BIT(1)	/**< @brief Register B: 24 hour format, BCD and no interrupts */
+#define REG_D_VRT		BIT(7)	/**< @brief Register D: the time is valid */
+
+static unsigned long address = 0;	/**< @brief Register selected through RTC_ADDR_REG */
+
+static unsigned long bcd(int value) {
+	return ((value / 10) << 4) | (value % 10);
+}
+
+void host_rtc_write(int port, unsigned long value) {
+	/* bit 7 of the address masks the NMI */
+	if(port == RTC_ADDR_REG) {
+		address = value & 0x7F;
+	}
+}
+
+unsigned long host_rtc_read(int port) {
+	time_t now;
+	struct tm *date;
+
+	if(port == RTC_ADDR_REG) {
+		return address;
+	}
+
+	now = host_time();
+	date = localtime(&now);
+
+	switch(address) {
+	case REG_SECONDS:
+		return bcd(date->tm_sec);
+	case REG_MINUTES:
+		return bcd(date->tm_min);
+	case REG_HOURS:
+		return bcd(date->tm_hour);
+	case REG_WEEK_DAY:
+		return bcd(date->tm_wday + 1);
+	case REG_MONTH_DAY:
+		return bcd(date->tm_mday);
+	case REG_MONTH:
+		return bcd(date->tm_mon + 1);
+	case REG_YEAR:
+		return bcd(date->tm_year % 100);
+	case RTC_REG_A:
+		/* never updating, so reads need no wait */
+		return 0x26;
+	case RTC_REG_B:
+		return REG_B_24H;
+	case RTC_REG_D:
+		return REG_D_VRT;
+	default:
+		return 0;
+	}
+}
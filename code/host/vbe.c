@@ -0,0 +1,286 @@
+/*
+ * vbe.c
+ *
+ * Emulated VBE 2.0 adapter: linear framebuffer modes in RAM, and the DAC.
+ */
+
+#include "host.h"
+#include "vbe.h"
+#include "pixfmt.h"
+
+#define VBE_OK				0x004F	/**< @brief AX of a successful VBE call */
+#define VBE_FAILED			0x014F	/**< @brief AX of a failed VBE call */
+#define MODE_MASK			0x01FF	/**< @brief Mode number bits of BX in function 0x02 */
+#define MODE_SUPPORTED		0x009B	/**< @brief Attributes: supported, color, graphics, linear framebuffer */
+#define MODEL_PACKED		4		/**< @brief Memory model of the indexed modes */
+#define MODEL_DIRECT		6		/**< @brief Memory model of the direct color modes */
+#define DAC_WIDTH			6		/**< @brief Bits per channel of the DAC after a mode set */
+
+/** @name Mode */
+/**@{
+ *
+ * Mode of the emulated adapter
+ */
+typedef struct {
+	unsigned short number;		/**< @brief VBE mode number */
+	unsigned short width;		/**< @brief horizontal resolution */
+	unsigned short height;		/**< @brief vertical resolution */
+	unsigned char bits;			/**< @brief bits per pixel */
+} MODE;
+/** @} end of Mode */
+
+static const MODE modes[] = {
+	{ 0x101, 640, 480, 8 }, { 0x103, 800, 600, 8 }, { 0x105, 1024, 768, 8 }, { 0x107, 1280, 1024, 8 },
+	{ 0x110, 640, 480, 15 }, { 0x111, 640, 480, 16 }, { 0x112, 640, 480, 24 },
+	{ 0x113, 800, 600, 15 }, { 0x114, 800, 600, 16 }, { 0x115, 800, 600, 24 },
+	{ 0x116, 1024, 768, 15 }, { 0x117, 1024, 768, 16 }, { 0x118, 1024, 768, 24 },
+	{ 0x119, 1280, 1024, 15 }, { 0x11A, 1280, 1024, 16 }, { 0x11B, 1280, 1024, 24 }
+};
+
+static host_screen_t screen;				/**< @brief Mode set, bits_per_pixel 0 in text mode */
+static unsigned char dac[PIXFMT_COLORS][3];	/**< @brief DAC entries */
+static unsigned int dac_width = DAC_WIDTH;	/**< @brief Bits per channel of the DAC */
+static unsigned int dac_read = 0;			/**< @brief Entry and channel read next from the DAC data port, times 3 */
+static unsigned int dac_write = 0;			/**< @brief Entry and channel written next to the DAC data port, times 3 */
+
+static const MODE *find_mode(unsigned int number) {
+	unsigned int i;
+
+	for(i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+		if(modes[i].number == number) {
+			return &modes[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Bits per pixel of a mode, with 24 bit modes made 32 bit by HOST_32BPP.
+ */
+static unsigned int mode_bits(const MODE *mode) {
+	if((mode->bits == 24) && (getenv("HOST_32BPP") != NULL)) {
+		return 32;
+	}
+	return mode->bits;
+}
+
+/**
+ * @brief Get the table a VBE call points at with ES:DI.
+ */
+static void *table(const struct reg86u *reg86p, size_t len) {
+	return host_lm_virtual(((phys_bytes)reg86p->u.w.es << 4) + reg86p->u.w.di, len);
+}
+
+/**
+ * @brief VBE function 0x01: return the mode info block.
+ */
+static int mode_info(struct reg86u *reg86p) {
+	vbe_mode_info_t *info = table(reg86p, sizeof(vbe_mode_info_t));
+	const MODE *mode = find_mode(reg86p->u.w.cx & MODE_MASK);
+	unsigned int bits;
+
+	if(info == NULL) {
+		return VBE_FAILED;
+	}
+	memset(info, 0, sizeof(vbe_mode_info_t));
+	if(mode == NULL) {
+		return VBE_FAILED;
+	}
+
+	bits = mode_bits(mode);
+	info->ModeAttributes = MODE_SUPPORTED;
+	info->BytesPerScanLine = mode->width * ((bits + 7) / 8);
+	info->LinBytesPerScanLine = info->BytesPerScanLine;
+	info->XResolution = mode->width;
+	info->YResolution = mode->height;
+	info->XCharSize = 8;
+	info->YCharSize = 16;
+	info->NumberOfPlanes = 1;
+	info->BitsPerPixel = bits;
+	info->NumberOfBanks = 1;
+	info->PhysBasePtr = HOST_VRAM_BASE;
+
+	if(bits == 8) {
+		info->MemoryModel = MODEL_PACKED;
+		return VBE_OK;
+	}
+
+	info->MemoryModel = MODEL_DIRECT;
+	switch(bits) {
+	case 15:
+		info->RedMaskSize = info->GreenMaskSize = info->BlueMaskSize = 5;
+		info->RedFieldPosition = 10;
+		info->GreenFieldPosition = 5;
+		info->RsvdMaskSize = 1;
+		info->RsvdFieldPosition = 15;
+		break;
+	case 16:
+		info->RedMaskSize = info->BlueMaskSize = 5;
+		info->GreenMaskSize = 6;
+		info->RedFieldPosition = 11;
+		info->GreenFieldPosition = 5;
+		break;
+	default:
+		info->RedMaskSize = info->GreenMaskSize = info->BlueMaskSize = 8;
+		info->RedFieldPosition = 16;
+		info->GreenFieldPosition = 8;
+		if(bits == 32) {
+			info->RsvdMaskSize = 8;
+			info->RsvdFieldPosition = 24;
+		}
+		break;
+	}
+	info->LinRedMaskSize = info->RedMaskSize;
+	info->LinRedFieldPosition = info->RedFieldPosition;
+	info->LinGreenMaskSize = info->GreenMaskSize;
+	info->LinGreenFieldPosition = info->GreenFieldPosition;
+	info->LinBlueMaskSize = info->BlueMaskSize;
+	info->LinBlueFieldPosition = info->BlueFieldPosition;
+
+	return VBE_OK;
+}
+
+/**
+ * @brief VBE function 0x02: set a mode, which clears the framebuffer and resets the DAC.
+ */
+static int set_mode(struct reg86u *reg86p) {
+	const MODE *mode = find_mode(reg86p->u.w.bx & MODE_MASK);
+	unsigned char *vram = host_fb_vram();
+	unsigned int i;
+
+	if((mode == NULL) || (vram == NULL)) {
+		return VBE_FAILED;
+	}
+
+	screen.pixels = vram;
+	screen.width = mode->width;
+	screen.height = mode->height;
+	screen.bits_per_pixel = mode_bits(mode);
+	screen.pitch = mode->width * ((screen.bits_per_pixel + 7) / 8);
+	memset(vram, 0, screen.pitch * screen.height);
+
+	dac_width = DAC_WIDTH;
+	for(i = 0; i < PIXFMT_COLORS; i++) {
+		pixfmt_palette_entry(i, dac[i]);
+	}
+	host_fb_mode(host_vbe_screen());
+
+	return VBE_OK;
+}
+
+/**
+ * @brief VBE function 0x09: set or get DAC entries, in the blue, green, red, unused layout.
+ */
+static int palette_data(struct reg86u *reg86p) {
+	unsigned int first = reg86p->u.w.dx, count = reg86p->u.w.cx, i;
+	unsigned char *entries = table(reg86p, count * 4);
+
+	if((entries == NULL) || (first + count > PIXFMT_COLORS)) {
+		return VBE_FAILED;
+	}
+
+	for(i = 0; i < count; i++) {
+		if(reg86p->u.b.bl == 0x01) {
+			entries[i*4] = dac[first + i][2];
+			entries[i*4 + 1] = dac[first + i][1];
+			entries[i*4 + 2] = dac[first + i][0];
+			entries[i*4 + 3] = 0;
+		}
+		else {
+			dac[first + i][0] = entries[i*4 + 2];
+			dac[first + i][1] = entries[i*4 + 1];
+			dac[first + i][2] = entries[i*4];
+		}
+	}
+	if(reg86p->u.b.bl != 0x01) {
+		host_fb_palette(first, count, (const unsigned char (*)[3])dac);
+	}
+
+	return VBE_OK;
+}
+
+int host_vbe_int10(struct reg86u *reg86p) {
+	if(reg86p->u.b.intno != 0x10) {
+		return -1;
+	}
+
+	/* AH 0x00: set a VGA mode, only the text mode is emulated */
+	if(reg86p->u.b.ah == 0x00) {
+		screen.bits_per_pixel = 0;
+		host_fb_mode(host_vbe_screen());
+		return 0;
+	}
+
+	switch(reg86p->u.w.ax) {
+	case 0x4F01:
+		reg86p->u.w.ax = mode_info(reg86p);
+		break;
+	case 0x4F02:
+		reg86p->u.w.ax = set_mode(reg86p);
+		break;
+	case 0x4F08:
+		/* the DAC switches to 8 bits when asked, anything else stays 6 */
+		if(reg86p->u.b.bl == 0x00) {
+			dac_width = (reg86p->u.b.bh == 8) ? 8 : DAC_WIDTH;
+			host_fb_mode(host_vbe_screen());
+		}
+		reg86p->u.b.bh = dac_width;
+		reg86p->u.w.ax = VBE_OK;
+		break;
+	case 0x4F09:
+		reg86p->u.w.ax = palette_data(reg86p);
+		break;
+	default:
+		reg86p->u.w.ax = VBE_FAILED;
+		break;
+	}
+
+	return 0;
+}
+
+void host_vbe_write(int port, unsigned long value) {
+	switch(port) {
+	case 0x3C7:
+		dac_read = (value & 0xFF) * 3;
+		break;
+	case 0x3C8:
+		dac_write = (value & 0xFF) * 3;
+		break;
+	case 0x3C9:
+		dac[dac_write / 3][dac_write % 3] = value & ((1 << dac_width) - 1);
+		if(dac_write % 3 == 2) {
+			host_fb_palette(dac_write / 3, 1, (const unsigned char (*)[3])dac);
+		}
+		dac_write = (dac_write + 1) % (PIXFMT_COLORS * 3);
+		break;
+	default:
+		break;
+	}
+}
+
+unsigned long host_vbe_read(int port) {
+	unsigned long value;
+
+	if(port != 0x3C9) {
+		return 0xFF;
+	}
+
+	value = dac[dac_read / 3][dac_read % 3];
+	dac_read = (dac_read + 1) % (PIXFMT_COLORS * 3);
+	return value;
+}
+
+void *host_vbe_map(phys_bytes base, size_t len) {
+	unsigned char *vram = host_fb_vram();
+
+	if((base < HOST_VRAM_BASE) || (base - HOST_VRAM_BASE + len > HOST_VRAM_SIZE) || (vram == NULL)) {
+		return NULL;
+	}
+	return vram + (base - HOST_VRAM_BASE);
+}
+
+const host_screen_t *host_vbe_screen() {
+	screen.dac = (const unsigned char (*)[3])dac;
+	screen.dac_width = dac_width;
+	return &screen;
+}
@@ -0,0 +1,619 @@
+/*
+ * vgbench.c
+ *
+ * Microbenchmarks of the video_gr primitives. Each primitive is timed over
+ * sizes, orientations and clip cases on an off-screen surface as large as
+ * the screen; presents are timed on the video buffer, whose VRAM is plain
+ * memory in host builds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "video_gr.h"
+#include "vbe.h"
+
+#define BENCH_MODE		0x105	/**< @brief Default VBE mode */
+#define BENCH_REPS		10		/**< @brief Default number of timed repetitions */
+#define BENCH_WARMUP	3		/**< @brief Default number of repetitions run before timing */
+#define BENCH_MIN_US	2000	/**< @brief Default shortest repetition; calls are doubled until one takes this long */
+#define BENCH_MAX_CASES	256		/**< @brief Room in the case table */
+#define BENCH_FILLS		16		/**< @brief Rectangles filled by one vg_fill_rects() call */
+#define BENCH_COLORS	15		/**< @brief Colors cycled through, 1 to BENCH_COLORS; 0 would not be counted as drawn */
+
+/** @name Output Formats */
+/**@{
+ *
+ * Ways of printing the results
+ */
+enum {
+	FORMAT_TEXT,	/**< @brief aligned table */
+	FORMAT_CSV,		/**< @brief one header line, then one line per case */
+	FORMAT_JSON		/**< @brief one object with the run's settings and an array of cases */
+};
+/** @} end of Output Formats */
+
+typedef struct bench_case bench_case_t;
+
+/** @name Bench Case */
+/**@{
+ *
+ * One primitive with one set of arguments
+ */
+struct bench_case {
+	const char *primitive;	/**< @brief name of the video_gr function */
+	char variant[32];		/**< @brief size or orientation of the arguments */
+	const char *clip;		/**< @brief "in", "edge" (partly outside the screen) or "out"; "-" if not drawn */
+	int (*call)(const bench_case_t *bench, unsigned int color);	/**< @brief calls the primitive once */
+	int x1;					/**< @brief x initial coordinate */
+	int y1;					/**< @brief y initial coordinate */
+	int x2;					/**< @brief x final coordinate */
+	int y2;					/**< @brief y final coordinate */
+	unsigned int size;		/**< @brief size argument */
+	char symbol;			/**< @brief char or digit drawn */
+	vg_surface_t *surface;	/**< @brief surface blitted or read to, NULL if none */
+	int present_mode;		/**< @brief present mode of vg_draw_buffer_to_mem() cases, -1 for draws */
+};
+/** @} end of Bench Case */
+
+/** @name Bench Result */
+/**@{
+ *
+ * Timing of a case
+ */
+typedef struct {
+	unsigned long calls;	/**< @brief calls per repetition */
+	unsigned long pixels;	/**< @brief pixels written (or read, or presented) by one call */
+	double mean;			/**< @brief mean ns per call over the repetitions */
+	double min;				/**< @brief fastest repetition, ns per call */
+	double max;				/**< @brief slowest repetition, ns per call */
+	double stddev;			/**< @brief standard deviation of the repetitions, ns per call */
+} bench_result_t;
+/** @} end of Bench Result */
+
+static bench_case_t cases[BENCH_MAX_CASES];	/**< @brief Cases, in the order they are run */
+static unsigned int case_count = 0;			/**< @brief Number of cases */
+static vg_surface_t *offscreen;				/**< @brief Surface the primitives draw to */
+static unsigned char *readback;				/**< @brief Destination of vg_read_rect(), as large as the screen */
+static unsigned int width;					/**< @brief Screen width */
+static unsigned int height;					/**< @brief Screen height */
+static unsigned int bytes;					/**< @brief Bytes per pixel */
+static unsigned int death_colors[8] = { 1, 2, 3, 4, 5, 6, 9, 12 };	/**< @brief Colors of the divisions of vg_draw_death_square() */
+static vg_fill_t fills[BENCH_FILLS];		/**< @brief Rectangles of the vg_fill_rects() cases */
+
+static double now_ns() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//*** PRIMITIVES ***
+
+static int call_set_pixel(const bench_case_t *bench, unsigned int color) {
+	return vg_set_pixel(bench->x1, bench->y1, color);
+}
+
+static int call_line(const bench_case_t *bench, unsigned int color) {
+	return vg_draw_line(bench->x1, bench->y1, bench->x2, bench->y2, color);
+}
+
+static int call_square(const bench_case_t *bench, unsigned int color) {
+	return vg_draw_square(bench->x1, bench->y1, bench->size, color);
+}
+
+static int call_rectangle(const bench_case_t *bench, unsigned int color) {
+	return vg_draw_rectangle(bench->x1, bench->y1, bench->x2, bench->y2, color);
+}
+
+static int call_fill_section(const bench_case_t *bench, unsigned int color) {
+	return vg_fill_section(bench->x1, bench->y1, bench->x2, bench->y2, color);
+}
+
+static int call_fill_rect(const bench_case_t *bench, unsigned int color) {
+	return vg_fill_rect(bench->x1, bench->y1, bench->x2, bench->y2, color);
+}
+
+static int call_fill_rects(const bench_case_t *bench, unsigned int color) {
+	return vg_fill_rects(fills, BENCH_FILLS);
+}
+
+static int call_fill(const bench_case_t *bench, unsigned int color) {
+	return vg_fill(color);
+}
+
+static int call_fill_polygon(const bench_case_t *bench, unsigned int color) {
+	vg_point_t points[3];
+
+	/* a triangle of the case's bounding box */
+	points[0].x = bench->x1;
+	points[0].y = bench->y2;
+	points[1].x = (bench->x1 + bench->x2) / 2;
+	points[1].y = bench->y1;
+	points[2].x = bench->x2;
+	points[2].y = bench->y2;
+
+	return vg_fill_polygon(points, 3, color);
+}
+
+static int call_death_square(const bench_case_t *bench, unsigned int color) {
+	return vg_draw_death_square(bench->x1, bench->y1, bench->size, death_colors);
+}
+
+static int call_char(const bench_case_t *bench, unsigned int color) {
+	return vg_draw_char(bench->x1, bench->y1, color, bench->symbol, bench->size);
+}
+
+static int call_special(const bench_case_t *bench, unsigned int color) {
+	return vg_draw_special(bench->x1, bench->y1, color, bench->symbol, bench->size);
+}
+
+static int call_number(const bench_case_t *bench, unsigned int color) {
+	return vg_draw_number(bench->x1, bench->y1, color, bench->symbol, bench->size);
+}
+
+static int call_blit_surface(const bench_case_t *bench, unsigned int color) {
+	return vg_blit_surface(bench->surface, bench->x1, bench->y1);
+}
+
+static int call_read_surface(const bench_case_t *bench, unsigned int color) {
+	return vg_read_surface(bench->surface, bench->x1, bench->y1);
+}
+
+static int call_read_rect(const bench_case_t *bench, unsigned int color) {
+	vg_rect_t rect = { bench->x1, bench->y1, bench->x2, bench->y2 };
+
+	return vg_read_rect(offscreen, &rect, readback, (bench->x2 - bench->x1) * bytes);
+}
+
+static int call_present(const bench_case_t *bench, unsigned int color) {
+	/* damage presents copy what was marked since the last one */
+	if(bench->size == 0) {
+		vg_mark_damage_all();
+	}
+	else if(bench->x1 < bench->x2) {
+		vg_mark_damage(bench->x1, bench->y1, bench->x2, bench->y2);
+	}
+	return vg_draw_buffer_to_mem();
+}
+
+//*** CASES ***
+
+/**
+ * @brief Add a case to the table.
+ *
+ * @return the case, so the caller can fill in what the primitive needs
+ */
+static bench_case_t *add_case(const char *primitive, const char *variant, const char *clip,
+		int (*call)(const bench_case_t *, unsigned int), int x1, int y1, int x2, int y2, unsigned int size) {
+	bench_case_t *bench;
+
+	if(case_count == BENCH_MAX_CASES) {
+		fprintf(stderr, "vgbench: more than %u cases\n", BENCH_MAX_CASES);
+		exit(1);
+	}
+
+	bench = &cases[case_count++];
+	bench->primitive = primitive;
+	snprintf(bench->variant, sizeof(bench->variant), "%s", variant);
+	bench->clip = clip;
+	bench->call = call;
+	bench->x1 = x1;
+	bench->y1 = y1;
+	bench->x2 = x2;
+	bench->y2 = y2;
+	bench->size = size;
+	bench->symbol = 0;
+	bench->surface = NULL;
+	bench->present_mode = -1;
+
+	return bench;
+}
+
+/**
+ * @brief Add a case of a primitive taking a box, placed inside, across the bottom right edge and outside of the screen.
+ */
+static void add_box_cases(const char *primitive, const char *variant, int (*call)(const bench_case_t *, unsigned int),
+		unsigned int box_width, unsigned int box_height, unsigned int size) {
+	int x = (width - box_width) / 2, y = (height - box_height) / 2;
+
+	add_case(primitive, variant, "in", call, x, y, x + box_width, y + box_height, size);
+	x = width - box_width / 2;
+	y = height - box_height / 2;
+	add_case(primitive, variant, "edge", call, x, y, x + box_width, y + box_height, size);
+	add_case(primitive, variant, "out", call, width + 16, height + 16, width + 16 + box_width, height + 16 + box_height, size);
+}
+
+/**
+ * @brief Add a line of an orientation, dx by dy long, inside, crossing the screen's top left corner and outside of it.
+ */
+static void add_line_cases(const char *variant, int dx, int dy) {
+	int x = (width - dx) / 2, y = (height - dy) / 2;
+
+	add_case("vg_draw_line", variant, "in", call_line, x, y, x + dx, y + dy, 0);
+	add_case("vg_draw_line", variant, "edge", call_line, -dx / 2, -dy / 2, dx - dx / 2, dy - dy / 2, 0);
+	add_case("vg_draw_line", variant, "out", call_line, -dx - 16, -dy - 16, -16, -16, 0);
+}
+
+/**
+ * @brief Create a surface, filled with a color if it is a blit source.
+ */
+static vg_surface_t *bench_surface(unsigned int size, unsigned int color) {
+	vg_surface_t *surface, *previous = vg_get_target();
+
+	if((surface = vg_surface_create(size, size)) == NULL) {
+		fprintf(stderr, "vgbench: out of memory\n");
+		exit(1);
+	}
+	if(color) {
+		vg_set_target(surface);
+		vg_fill(color);
+		vg_set_target(previous);
+	}
+
+	return surface;
+}
+
+static void build_cases() {
+	static const unsigned int lengths[] = { 16, 256 };
+	static const unsigned int boxes[] = { 8, 64, 256 };
+	static const unsigned int glyph_sizes[] = { 1, 2, 4, 8 };
+	static const unsigned int death_sizes[] = { 16, 64, 256 };
+	static const unsigned int sprites[] = { 64, 256 };
+	char variant[32];
+	unsigned int i, char_width, char_height;
+	bench_case_t *bench;
+
+	add_case("vg_set_pixel", "1", "in", call_set_pixel, width / 2, height / 2, 0, 0, 0);
+	add_case("vg_set_pixel", "1", "out", call_set_pixel, width + 16, height / 2, 0, 0, 0);
+
+	for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		snprintf(variant, sizeof(variant), "horizontal %u", lengths[i]);
+		add_line_cases(variant, lengths[i], 0);
+		snprintf(variant, sizeof(variant), "vertical %u", lengths[i]);
+		add_line_cases(variant, 0, lengths[i]);
+		snprintf(variant, sizeof(variant), "diagonal %u", lengths[i]);
+		add_line_cases(variant, lengths[i], lengths[i]);
+		snprintf(variant, sizeof(variant), "shallow %u", lengths[i]);
+		add_line_cases(variant, lengths[i], lengths[i] / 4);
+		snprintf(variant, sizeof(variant), "steep %u", lengths[i]);
+		add_line_cases(variant, lengths[i] / 4, lengths[i]);
+	}
+
+	for(i = 0; i < sizeof(boxes) / sizeof(boxes[0]); i++) {
+		snprintf(variant, sizeof(variant), "%ux%u", boxes[i], boxes[i]);
+		add_box_cases("vg_draw_square", variant, call_square, boxes[i], boxes[i], boxes[i]);
+		add_box_cases("vg_draw_rectangle", variant, call_rectangle, boxes[i], boxes[i], 0);
+		add_box_cases("vg_fill_section", variant, call_fill_section, boxes[i], boxes[i], 0);
+		add_box_cases("vg_fill_rect", variant, call_fill_rect, boxes[i], boxes[i], 0);
+		add_box_cases("vg_fill_polygon", variant, call_fill_polygon, boxes[i], boxes[i], 0);
+	}
+	snprintf(variant, sizeof(variant), "%ux%u", width, height);
+	add_case("vg_fill_section", variant, "in", call_fill_section, 0, 0, width, height, 0);
+	add_case("vg_fill", variant, "in", call_fill, 0, 0, width, height, 0);
+
+	/* a row of rectangles, like the bars of the side menu */
+	for(i = 0; i < BENCH_FILLS; i++) {
+		fills[i].rect.x1 = 32 + i * 40;
+		fills[i].rect.y1 = 32;
+		fills[i].rect.x2 = fills[i].rect.x1 + 32;
+		fills[i].rect.y2 = 64;
+		fills[i].color = 1 + i % BENCH_COLORS;
+	}
+	snprintf(variant, sizeof(variant), "%u of 32x32", BENCH_FILLS);
+	add_case("vg_fill_rects", variant, "in", call_fill_rects, 0, 0, 0, 0, 0);
+
+	for(i = 0; i < sizeof(death_sizes) / sizeof(death_sizes[0]); i++) {
+		snprintf(variant, sizeof(variant), "%u", death_sizes[i]);
+		add_box_cases("vg_draw_death_square", variant, call_death_square, death_sizes[i] + 1, death_sizes[i] + 1, death_sizes[i]);
+	}
+
+	for(i = 0; i < sizeof(glyph_sizes) / sizeof(glyph_sizes[0]); i++) {
+		snprintf(variant, sizeof(variant), "'w' size %u", glyph_sizes[i]);
+		vg_char_extent(glyph_sizes[i], &char_width, &char_height);
+		add_box_cases("vg_draw_char", variant, call_char, char_width, char_height, glyph_sizes[i]);
+		for(bench = &cases[case_count - 3]; bench < &cases[case_count]; bench++) {
+			bench->symbol = 'w';
+		}
+
+		snprintf(variant, sizeof(variant), "8 size %u", glyph_sizes[i]);
+		vg_number_extent(glyph_sizes[i], &char_width, &char_height);
+		add_box_cases("vg_draw_number", variant, call_number, char_width, char_height, glyph_sizes[i]);
+		for(bench = &cases[case_count - 3]; bench < &cases[case_count]; bench++) {
+			bench->symbol = 8;
+		}
+	}
+	bench = add_case("vg_draw_special", "'(' size 8", "in", call_special, width / 2, height / 2, 0, 0, 8);
+	bench->symbol = '(';
+
+	for(i = 0; i < sizeof(sprites) / sizeof(sprites[0]); i++) {
+		snprintf(variant, sizeof(variant), "%ux%u", sprites[i], sprites[i]);
+		add_box_cases("vg_blit_surface", variant, call_blit_surface, sprites[i], sprites[i], 0);
+		for(bench = &cases[case_count - 3]; bench < &cases[case_count]; bench++) {
+			bench->surface = bench_surface(sprites[i], 1 + i);
+		}
+		add_box_cases("vg_read_surface", variant, call_read_surface, sprites[i], sprites[i], 0);
+		for(bench = &cases[case_count - 3]; bench < &cases[case_count]; bench++) {
+			bench->surface = bench_surface(sprites[i], 0);
+		}
+		add_box_cases("vg_read_rect", variant, call_read_rect, sprites[i], sprites[i], 0);
+	}
+	snprintf(variant, sizeof(variant), "%ux%u", width, height);
+	add_case("vg_read_rect", variant, "in", call_read_rect, 0, 0, width, height, 0);
+
+	/* size 0 marks the whole screen, x1 == x2 marks nothing */
+	bench = add_case("vg_draw_buffer_to_mem", "damage full", "-", call_present, 0, 0, width, height, 0);
+	bench->present_mode = VG_PRESENT_DAMAGE;
+	bench = add_case("vg_draw_buffer_to_mem", "damage 64x64", "-", call_present, 64, 64, 128, 128, 1);
+	bench->present_mode = VG_PRESENT_DAMAGE;
+	bench = add_case("vg_draw_buffer_to_mem", "damage none", "-", call_present, 0, 0, 0, 0, 1);
+	bench->present_mode = VG_PRESENT_DAMAGE;
+	bench = add_case("vg_draw_buffer_to_mem", "diff unchanged", "-", call_present, 0, 0, 0, 0, 1);
+	bench->present_mode = VG_PRESENT_DIFF;
+}
+
+//*** MEASUREMENT ***
+
+static unsigned long count_set(const unsigned char *pixels, unsigned long pitch, unsigned int columns, unsigned int rows) {
+	unsigned long count = 0;
+	unsigned int x, y, b;
+	const unsigned char *pixel;
+
+	for(y = 0; y < rows; y++) {
+		for(x = 0; x < columns; x++) {
+			pixel = pixels + y * pitch + x * bytes;
+			for(b = 0; b < bytes; b++) {
+				if(pixel[b]) {
+					count++;
+					break;
+				}
+			}
+		}
+	}
+
+	return count;
+}
+
+/**
+ * @brief Count the pixels one call writes, reads or presents.
+ *
+ * Drawn pixels are counted on a cleared target, read ones in a cleared
+ * destination read from a filled target.
+ */
+static unsigned long count_pixels(const bench_case_t *bench) {
+	const vg_present_stats_t *stats;
+
+	if(bench->present_mode != -1) {
+		bench->call(bench, 1);
+		stats = vg_get_present_stats();
+		return stats->bytes_uploaded / bytes;
+	}
+
+	if(bench->call == call_read_surface) {
+		vg_fill(1);
+		memset(bench->surface->pixels, 0, bench->surface->pitch * bench->surface->height);
+		bench->call(bench, 1);
+		return count_set(bench->surface->pixels, bench->surface->pitch, bench->surface->width, bench->surface->height);
+	}
+	if(bench->call == call_read_rect) {
+		vg_fill(1);
+		memset(readback, 0, width * height * bytes);
+		bench->call(bench, 1);
+		return count_set(readback, (bench->x2 - bench->x1) * bytes, bench->x2 - bench->x1, bench->y2 - bench->y1);
+	}
+
+	memset(offscreen->pixels, 0, offscreen->pitch * offscreen->height);
+	bench->call(bench, 1);
+	return count_set(offscreen->pixels, offscreen->pitch, offscreen->width, offscreen->height);
+}
+
+/**
+ * @brief Time calls of a case.
+ *
+ * @return ns per call
+ */
+static double time_calls(const bench_case_t *bench, unsigned long calls) {
+	unsigned long i;
+	double start = now_ns();
+
+	for(i = 0; i < calls; i++) {
+		bench->call(bench, 1 + i % BENCH_COLORS);
+	}
+
+	return (now_ns() - start) / calls;
+}
+
+static void run_case(const bench_case_t *bench, unsigned int reps, unsigned int warmup, unsigned long min_us, bench_result_t *result) {
+	double sample, sum = 0, squares = 0;
+	unsigned int rep;
+
+	if(bench->present_mode != -1) {
+		vg_set_target(NULL);
+		vg_set_present_mode(bench->present_mode);
+		/* the first present after a mode change is whole */
+		vg_draw_buffer_to_mem();
+	}
+
+	result->pixels = count_pixels(bench);
+
+	for(result->calls = 1; time_calls(bench, result->calls) * result->calls < min_us * 1000.0; result->calls *= 2);
+	for(rep = 0; rep < warmup; rep++) {
+		time_calls(bench, result->calls);
+	}
+
+	result->min = 0;
+	result->max = 0;
+	for(rep = 0; rep < reps; rep++) {
+		sample = time_calls(bench, result->calls);
+		if((rep == 0) || (sample < result->min)) {
+			result->min = sample;
+		}
+		if(sample > result->max) {
+			result->max = sample;
+		}
+		sum += sample;
+		squares += sample * sample;
+	}
+	result->mean = sum / reps;
+	result->stddev = (reps > 1) ? sqrt((squares - sum * sum / reps) / (reps - 1)) : 0;
+	if(result->stddev != result->stddev) {
+		/* rounding may leave the difference slightly negative */
+		result->stddev = 0;
+	}
+
+	if(bench->present_mode != -1) {
+		vg_set_present_mode(VG_PRESENT_DAMAGE);
+		vg_set_target(offscreen);
+	}
+}
+
+//*** OUTPUT ***
+
+static void print_header(int format, unsigned short mode, unsigned int reps, unsigned int warmup, unsigned long min_us) {
+	switch(format) {
+	case FORMAT_CSV:
+		printf("primitive,variant,clip,pixels,calls,ns_call_mean,ns_call_min,ns_call_max,ns_call_stddev,ns_pixel\n");
+		break;
+	case FORMAT_JSON:
+		printf("{\n  \"mode\": \"%x\", \"width\": %u, \"height\": %u, \"bytes_per_pixel\": %u,\n", mode, width, height, bytes);
+		printf("  \"reps\": %u, \"warmup\": %u, \"min_us\": %lu,\n  \"cases\": [", reps, warmup, min_us);
+		break;
+	default:
+		printf("mode %x, %ux%u, %u bytes per pixel, %u repetitions of at least %lu us after %u warm-up ones\n\n",
+				mode, width, height, bytes, reps, min_us, warmup);
+		printf("%-22s %-16s %-5s %8s %10s %10s %10s %10s\n", "primitive", "variant", "clip", "pixels", "ns/call", "min", "stddev", "ns/pixel");
+		break;
+	}
+}
+
+static void print_result(int format, const bench_case_t *bench, const bench_result_t *result, int first) {
+	char per_pixel[32];
+
+	switch(format) {
+	case FORMAT_CSV:
+		if(result->pixels) {
+			snprintf(per_pixel, sizeof(per_pixel), "%.4f", result->mean / result->pixels);
+		}
+		else {
+			per_pixel[0] = '\0';
+		}
+		printf("%s,\"%s\",%s,%lu,%lu,%.2f,%.2f,%.2f,%.2f,%s\n", bench->primitive, bench->variant, bench->clip, result->pixels,
+				result->calls, result->mean, result->min, result->max, result->stddev, per_pixel);
+		break;
+	case FORMAT_JSON:
+		snprintf(per_pixel, sizeof(per_pixel), result->pixels ? "%.4f" : "null", result->mean / (result->pixels ? result->pixels : 1));
+		printf("%s\n    { \"primitive\": \"%s\", \"variant\": \"%s\", \"clip\": \"%s\", \"pixels\": %lu, \"calls\": %lu,\n"
+				"      \"ns_call_mean\": %.2f, \"ns_call_min\": %.2f, \"ns_call_max\": %.2f, \"ns_call_stddev\": %.2f, \"ns_pixel\": %s }",
+				first ? "" : ",", bench->primitive, bench->variant, bench->clip, result->pixels, result->calls,
+				result->mean, result->min, result->max, result->stddev, per_pixel);
+		break;
+	default:
+		if(result->pixels) {
+			snprintf(per_pixel, sizeof(per_pixel), "%.3f", result->mean / result->pixels);
+		}
+		else {
+			snprintf(per_pixel, sizeof(per_pixel), "-");
+		}
+		printf("%-22s %-16s %-5s %8lu %10.1f %10.1f %10.1f %10s\n", bench->primitive, bench->variant, bench->clip,
+				result->pixels, result->mean, result->min, result->stddev, per_pixel);
+		fflush(stdout);
+		break;
+	}
+}
+
+static void print_usage(char *argv[]) {
+	fprintf(stderr, "Usage: %s [mode=<hex mode>] [reps=<n>] [warmup=<n>] [min_us=<n>] [only=<primitive>] [format=text|csv|json]\n"
+			"\t mode:   VBE mode the buffers are laid out for (default %x)\n"
+			"\t reps:   timed repetitions of each case (default %u)\n"
+			"\t warmup: repetitions run before timing (default %u)\n"
+			"\t min_us: shortest repetition, calls are doubled until one takes this long (default %u)\n"
+			"\t only:   run the cases of one primitive, e.g. vg_draw_line\n",
+			argv[0], BENCH_MODE, BENCH_REPS, BENCH_WARMUP, BENCH_MIN_US);
+}
+
+int main(int argc, char *argv[]) {
+	unsigned short mode = BENCH_MODE;
+	unsigned int reps = BENCH_REPS, warmup = BENCH_WARMUP, i, shown = 0;
+	unsigned long min_us = BENCH_MIN_US, value;
+	const char *only = NULL;
+	int format = FORMAT_TEXT;
+	vbe_mode_info_t info;
+	bench_result_t result;
+	char *end;
+
+	for(i = 1; i < (unsigned int)argc; i++) {
+		end = "";
+		if(strncmp(argv[i], "mode=", strlen("mode=")) == 0) {
+			value = strtoul(argv[i] + strlen("mode="), &end, 16);
+			if((value == 0) || (value > 0xFFFF)) {
+				end = "x";
+			}
+			mode = value;
+		}
+		else if(strncmp(argv[i], "reps=", strlen("reps=")) == 0) {
+			reps = strtoul(argv[i] + strlen("reps="), &end, 10);
+			if(reps == 0) {
+				end = "x";
+			}
+		}
+		else if(strncmp(argv[i], "warmup=", strlen("warmup=")) == 0) {
+			warmup = strtoul(argv[i] + strlen("warmup="), &end, 10);
+		}
+		else if(strncmp(argv[i], "min_us=", strlen("min_us=")) == 0) {
+			min_us = strtoul(argv[i] + strlen("min_us="), &end, 10);
+		}
+		else if(strncmp(argv[i], "only=", strlen("only=")) == 0) {
+			only = argv[i] + strlen("only=");
+		}
+		else if(strcmp(argv[i], "format=text") == 0) {
+			format = FORMAT_TEXT;
+		}
+		else if(strcmp(argv[i], "format=csv") == 0) {
+			format = FORMAT_CSV;
+		}
+		else if(strcmp(argv[i], "format=json") == 0) {
+			format = FORMAT_JSON;
+		}
+		else {
+			end = "x";
+		}
+		if(*end != '\0') {
+			print_usage(argv);
+			return 1;
+		}
+	}
+
+	if((vbe_get_mode_info(mode, &info) != 0) || (vg_init(mode) != 0)) {
+		fprintf(stderr, "%s: mode %x could not be set\n", argv[0], mode);
+		return 1;
+	}
+	width = info.XResolution;
+	height = info.YResolution;
+	bytes = vg_get_bytes_per_pixel();
+
+	if(((offscreen = vg_surface_create(width, height)) == NULL) || ((readback = malloc(width * height * bytes)) == NULL)) {
+		vg_exit();
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+	vg_set_target(offscreen);
+	build_cases();
+
+	print_header(format, mode, reps, warmup, min_us);
+	for(i = 0; i < case_count; i++) {
+		if((only != NULL) && (strcmp(only, cases[i].primitive) != 0)) {
+			continue;
+		}
+		run_case(&cases[i], reps, warmup, min_us, &result);
+		print_result(format, &cases[i], &result, shown++ == 0);
+	}
+	if(format == FORMAT_JSON) {
+		printf("\n  ]\n}\n");
+	}
+
+	vg_exit();
+
+	return 0;
+}
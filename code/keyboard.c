@@ -8,6 +8,8 @@
 #include "keyboard.h"
 #include "i8042.h"
 
+static int keyboard_hook_id;	/**< @brief Hook id the kernel returned, which sys_irqrmpolicy() takes */
+
 int keyboard_set_leds(unsigned short int number) {
 
 	unsigned long stat;
@@ -62,9 +64,9 @@ int keyboard_set_leds(unsigned short int number) {
 
 int keyboard_subscribe_int(const unsigned int keyboard_id) {
 
-	unsigned int hook_id = keyboard_id;
+	keyboard_hook_id = keyboard_id;
 
-	if(sys_irqsetpolicy(KBC_IRQ, IRQ_REENABLE | IRQ_EXCLUSIVE, &hook_id) != OK) {
+	if(sys_irqsetpolicy(KBC_IRQ, IRQ_REENABLE | IRQ_EXCLUSIVE, &keyboard_hook_id) != OK) {
 		//printf("keyboard sys_irqsetpolicy() failed!\n");
 		return -1;
 	}
@@ -75,9 +77,7 @@ int keyboard_subscribe_int(const unsigned int keyboard_id) {
 
 int keyboard_unsubscribe_int(const unsigned int keyboard_id) {
 
-	unsigned int hook_id = keyboard_id;
-
-	if (!sys_irqrmpolicy(&hook_id)) {
+	if (sys_irqrmpolicy(&keyboard_hook_id) != OK) {
 		//printf("keyboard sys_irqrmpolicy() failed!\n");
 		return -1;
 	}
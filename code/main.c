@@ -7,8 +7,18 @@
 
 #include "libraries.h"
 #include "devices.h"
+#include "video_gr.h"
+#include "game.h"
 
-const long int vg_init_mode = 0x105;
+static unsigned short vg_init_mode = 0x105;	/**< @brief VBE mode, 1024x768; may be given as an argument */
+static unsigned int seed;					/**< @brief Seed of the game's random numbers; may be given as an argument */
+static char *record_path = NULL;			/**< @brief File the keys are recorded to, NULL if not recording */
+static char *replay_path = NULL;			/**< @brief Input recording the simulation replays, NULL for synthetic input */
+static unsigned long sim_ticks = 0;			/**< @brief Logic steps of the simulation, 0 for the default */
+static char *golden_path = NULL;			/**< @brief Golden file of a golden frame run */
+static int golden_record = 0;				/**< @brief The golden frame run records the golden file instead of checking it */
+static int golden_times = 1;				/**< @brief The golden file is recorded with the frame times */
+static int golden_tolerance = -1;			/**< @brief Percent a step may be slower than its golden time, -1 for no timing check */
 
 static void print_usage(char *argv[]);
 static int proc_args(int argc, char *argv[]);
@@ -20,7 +30,7 @@ int main(int argc, char **argv) {
 	int state = 0;
 	int debugmode = 0;
 
-	srand(time(NULL));
+	seed = time(NULL);
 
 	if ( argc == 1 ) {
 		print_usage(argv);
@@ -29,14 +39,34 @@ int main(int argc, char **argv) {
 
 		if((debugmode = proc_args(argc, argv)) > -1) {
 
-			/**
-			 * Called initially because of the unknown issue which makes colors less bright on the first time.
-			 */
-			vg_init(vg_init_mode);
-			vg_exit();
+			srand(seed);
 
-			if(!debugmode) {
-				vg_init(vg_init_mode);
+			if(debugmode == 2) { /* simulation: no video mode and no interrupts */
+				/* a replay runs to the end of the recording unless told otherwise */
+				if((sim_ticks == 0) && (replay_path == NULL)) {
+					sim_ticks = SIM_TICKS;
+				}
+				return simLoop(sim_ticks, replay_path);
+			}
+
+			if(debugmode == 3) { /* golden frames: video mode, no interrupts */
+				if(vg_init(vg_init_mode) != 0) {
+					printf("\n ------> Error setting the video mode %X! Exiting...\n", vg_init_mode);
+					return -1;
+				}
+				state = goldenLoop(golden_path, golden_record, golden_times, golden_tolerance);
+				vg_exit();
+				return state;
+			}
+
+			if((record_path != NULL) && (recordInput(record_path, seed) != 0)) {
+				printf("\n ------> Error creating %s! Exiting...\n", record_path);
+				return -1;
+			}
+
+			if(!debugmode && (vg_init(vg_init_mode) != 0)) {
+				printf("\n ------> Error setting the video mode %X! Exiting...\n", vg_init_mode);
+				return -1;
 			}
 
 			state = devices_startup(); /* Start all devices. Any errors will be stored in state and handled/reported below. */
@@ -110,21 +140,136 @@ int main(int argc, char **argv) {
 static void print_usage(char *argv[]) {
   printf("Usage: one of the following:\n"
 	 "\t service run %s -args \"game\" \n"
-	 "\t service run %s -args \"debug\" \n",
-	 argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+	 "\t service run %s -args \"game <hex mode: 105, 116, 117 or 118>\" \n"
+	 "\t service run %s -args \"game [hex mode] diff\" (present only what differs from VRAM) \n"
+	 "\t service run %s -args \"game [hex mode] [diff] scale=<1 to 4>\" (draw at a lower resolution) \n"
+	 "\t service run %s -args \"debug\" \n"
+	 "\t service run %s -args \"overdraw [hex mode] [scale=<1 to 4>]\" (show how many times each pixel is drawn) \n"
+	 "\t service run %s -args \"game [...] record=<file>\" (record the keys pressed while playing) \n"
+	 "\t service run %s -args \"sim [ticks=<n>] [seed=<n>] [replay=<file>]\" (run the game logic as fast as possible) \n"
+	 "\t service run %s -args \"golden [hex mode] [scale=<1 to 4>] record=<file> [times=off]\" (record the frames of a scripted run, and their times) \n"
+	 "\t service run %s -args \"golden [hex mode] [scale=<1 to 4>] check=<file> [tolerance=<percent>]\" (check a scripted run against them, and its times if recorded on this machine) \n",
+	 argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
 }
 
 static int proc_args(int argc, char *argv[]) {
 	unsigned short duration;
-	if (strncmp(argv[1], "game", strlen("game")) == 0) {
-		if( argc != 2 ) {
+	char *end;
+	unsigned long mode;
+	int i;
+	if ((strncmp(argv[1], "game", strlen("game")) == 0) || (strncmp(argv[1], "overdraw", strlen("overdraw")) == 0)) {
+		if( (argc < 2) || (argc > 6) ) {
 			printf("-> test: wrong no of arguments to run the game \n");
 			return -1;
 		}
+		for( i = 2; i < argc; i++ ) {
+			if( strcmp(argv[i], "diff") == 0 ) {
+				vg_set_present_mode(VG_PRESENT_DIFF);
+				continue;
+			}
+			if( strncmp(argv[i], "record=", strlen("record=")) == 0 ) {
+				record_path = argv[i] + strlen("record=");
+				continue;
+			}
+			if( strncmp(argv[i], "scale=", strlen("scale=")) == 0 ) {
+				if( vg_set_render_scale(strtoul(argv[i] + strlen("scale="), &end, 10)) != 0 || (*end != '\0') ) {
+					printf("-> test: %s is not a valid render scale \n", argv[i]);
+					return -1;
+				}
+				continue;
+			}
+			mode = strtoul(argv[i], &end, 16);
+			if( (*end != '\0') || (mode == 0) || (mode > 0xFFFF) ) {
+				printf("-> test: %s is not a valid VBE mode \n", argv[i]);
+				return -1;
+			}
+			vg_init_mode = mode;
+		}
+
+		if (strncmp(argv[1], "overdraw", strlen("overdraw")) == 0) {
+			vg_set_overdraw(1);
+			printf("-> Run the game showing overdraw! \n");
+			return 0;
+		}
 
 		printf("-> Run the game! \n");
 		return 0;
 	}
+	else if (strncmp(argv[1], "sim", strlen("sim")) == 0) {
+		for( i = 2; i < argc; i++ ) {
+			if( strncmp(argv[i], "ticks=", strlen("ticks=")) == 0 ) {
+				sim_ticks = strtoul(argv[i] + strlen("ticks="), &end, 10);
+			}
+			else if( strncmp(argv[i], "seed=", strlen("seed=")) == 0 ) {
+				seed = strtoul(argv[i] + strlen("seed="), &end, 10);
+			}
+			else if( strncmp(argv[i], "replay=", strlen("replay=")) == 0 ) {
+				replay_path = argv[i] + strlen("replay=");
+				continue;
+			}
+			else {
+				printf("-> test: %s is not a simulation argument \n", argv[i]);
+				return -1;
+			}
+			if( *end != '\0' ) {
+				printf("-> test: %s is not a number \n", argv[i]);
+				return -1;
+			}
+		}
+
+		printf("-> Simulate the game! \n");
+		return 2;
+	}
+	else if (strncmp(argv[1], "golden", strlen("golden")) == 0) {
+		for( i = 2; i < argc; i++ ) {
+			if( strncmp(argv[i], "record=", strlen("record=")) == 0 ) {
+				golden_path = argv[i] + strlen("record=");
+				golden_record = 1;
+				continue;
+			}
+			if( strncmp(argv[i], "check=", strlen("check=")) == 0 ) {
+				golden_path = argv[i] + strlen("check=");
+				golden_record = 0;
+				continue;
+			}
+			if( strcmp(argv[i], "times=off") == 0 ) {
+				golden_times = 0;
+				continue;
+			}
+			if( strcmp(argv[i], "tolerance=off") == 0 ) {
+				golden_tolerance = -1;
+				continue;
+			}
+			if( strncmp(argv[i], "tolerance=", strlen("tolerance=")) == 0 ) {
+				golden_tolerance = strtoul(argv[i] + strlen("tolerance="), &end, 10);
+				if( *end != '\0' ) {
+					printf("-> test: %s is not a valid tolerance \n", argv[i]);
+					return -1;
+				}
+				continue;
+			}
+			if( strncmp(argv[i], "scale=", strlen("scale=")) == 0 ) {
+				if( vg_set_render_scale(strtoul(argv[i] + strlen("scale="), &end, 10)) != 0 || (*end != '\0') ) {
+					printf("-> test: %s is not a valid render scale \n", argv[i]);
+					return -1;
+				}
+				continue;
+			}
+			mode = strtoul(argv[i], &end, 16);
+			if( (*end != '\0') || (mode == 0) || (mode > 0xFFFF) ) {
+				printf("-> test: %s is not a valid VBE mode \n", argv[i]);
+				return -1;
+			}
+			vg_init_mode = mode;
+		}
+		if( golden_path == NULL ) {
+			printf("-> test: golden needs record=<file> or check=<file> \n");
+			return -1;
+		}
+
+		printf("-> Run the golden frames! \n");
+		return 3;
+	}
 	else if (strncmp(argv[1], "debug", strlen("debug")) == 0) {
 		if( argc != 2 ) {
 			printf("-> test: wrong no of arguments to run the game in debugmode \n");
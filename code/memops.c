@@ -0,0 +1,300 @@
+/*
+ * memops.c
+ *
+ * Fast memory copies and fills for the video buffer.
+ */
+
+#include "memops.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define STREAM_ALIGN	16	/**< @brief Alignment required by the streaming stores */
+
+static void copy_byte(void *dst, const void *src, unsigned long size);
+static void copy_word(void *dst, const void *src, unsigned long size);
+static void copy_qword(void *dst, const void *src, unsigned long size);
+#ifdef __SSE2__
+static void copy_stream(void *dst, const void *src, unsigned long size);
+#endif
+static void copy_libc(void *dst, const void *src, unsigned long size);
+
+mem_copy_fn mem_copy = copy_word;
+
+static unsigned int selected = MEM_COPY_WORD;	/**< @brief Selected variant */
+static unsigned long long cycles[MEM_COPY_VARIANTS];	/**< @brief Best times of the last calibration */
+
+static const char *names[MEM_COPY_VARIANTS] = {
+		"byte",
+		"word",
+		"qword",
+		"stream",
+		"libc"
+};
+
+static const mem_copy_fn variants[MEM_COPY_VARIANTS] = {
+		copy_byte,
+		copy_word,
+		copy_qword,
+#ifdef __SSE2__
+		copy_stream,
+#else
+		NULL,
+#endif
+		copy_libc
+};
+
+unsigned long long mem_read_cycles() {
+#if defined(__i386__) || defined(__x86_64__)
+	unsigned int lo, hi;
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((unsigned long long)hi << 32) | lo;
+#else
+	return clock();
+#endif
+}
+
+static void copy_byte(void *dst, const void *src, unsigned long size) {
+	unsigned char *d = dst;
+	const unsigned char *s = src;
+
+	while(size--) {
+		*d++ = *s++;
+	}
+}
+
+static void copy_word(void *dst, const void *src, unsigned long size) {
+	unsigned char *d = dst;
+	const unsigned char *s = src;
+	uint32_t *dw;
+	uint32_t w0, w1, w2, w3;
+
+	/* head: bring the destination to a word boundary */
+	while(size && ((uintptr_t)d & (sizeof(uint32_t) - 1))) {
+		*d++ = *s++;
+		size--;
+	}
+
+	/* the source may be unaligned: it is loaded through memcpy(), which compiles to plain loads */
+	dw = (uint32_t *)d;
+	for(; size >= 4*sizeof(uint32_t); size -= 4*sizeof(uint32_t), dw += 4, s += 4*sizeof(uint32_t)) {
+		memcpy(&w0, s, sizeof(uint32_t));
+		memcpy(&w1, s + sizeof(uint32_t), sizeof(uint32_t));
+		memcpy(&w2, s + 2*sizeof(uint32_t), sizeof(uint32_t));
+		memcpy(&w3, s + 3*sizeof(uint32_t), sizeof(uint32_t));
+		dw[0] = w0;
+		dw[1] = w1;
+		dw[2] = w2;
+		dw[3] = w3;
+	}
+	for(; size >= sizeof(uint32_t); size -= sizeof(uint32_t), s += sizeof(uint32_t)) {
+		memcpy(&w0, s, sizeof(uint32_t));
+		*dw++ = w0;
+	}
+
+	/* tail */
+	d = (unsigned char *)dw;
+	while(size--) {
+		*d++ = *s++;
+	}
+}
+
+static void copy_qword(void *dst, const void *src, unsigned long size) {
+	unsigned char *d = dst;
+	const unsigned char *s = src;
+	uint64_t *dq;
+	uint64_t q0, q1, q2, q3;
+
+	while(size && ((uintptr_t)d & (sizeof(uint64_t) - 1))) {
+		*d++ = *s++;
+		size--;
+	}
+
+	dq = (uint64_t *)d;
+	for(; size >= 4*sizeof(uint64_t); size -= 4*sizeof(uint64_t), dq += 4, s += 4*sizeof(uint64_t)) {
+		memcpy(&q0, s, sizeof(uint64_t));
+		memcpy(&q1, s + sizeof(uint64_t), sizeof(uint64_t));
+		memcpy(&q2, s + 2*sizeof(uint64_t), sizeof(uint64_t));
+		memcpy(&q3, s + 3*sizeof(uint64_t), sizeof(uint64_t));
+		dq[0] = q0;
+		dq[1] = q1;
+		dq[2] = q2;
+		dq[3] = q3;
+	}
+	for(; size >= sizeof(uint64_t); size -= sizeof(uint64_t), s += sizeof(uint64_t)) {
+		memcpy(&q0, s, sizeof(uint64_t));
+		*dq++ = q0;
+	}
+
+	d = (unsigned char *)dq;
+	while(size--) {
+		*d++ = *s++;
+	}
+}
+
+#ifdef __SSE2__
+static void copy_stream(void *dst, const void *src, unsigned long size) {
+	unsigned char *d = dst;
+	const unsigned char *s = src;
+	__m128i *dv;
+	const __m128i *sv;
+
+	while(size && ((uintptr_t)d & (STREAM_ALIGN - 1))) {
+		*d++ = *s++;
+		size--;
+	}
+
+	/* non-temporal stores bypass the cache and fill whole write-combining lines */
+	dv = (__m128i *)d;
+	sv = (const __m128i *)s;
+	for(; size >= 4*STREAM_ALIGN; size -= 4*STREAM_ALIGN, dv += 4, sv += 4) {
+		_mm_stream_si128(dv, _mm_loadu_si128(sv));
+		_mm_stream_si128(dv + 1, _mm_loadu_si128(sv + 1));
+		_mm_stream_si128(dv + 2, _mm_loadu_si128(sv + 2));
+		_mm_stream_si128(dv + 3, _mm_loadu_si128(sv + 3));
+	}
+	for(; size >= STREAM_ALIGN; size -= STREAM_ALIGN) {
+		_mm_stream_si128(dv++, _mm_loadu_si128(sv++));
+	}
+	_mm_sfence();
+
+	copy_word(dv, sv, size);
+}
+#endif
+
+static void copy_libc(void *dst, const void *src, unsigned long size) {
+	memcpy(dst, src, size);
+}
+
+int mem_copy_select(unsigned int variant) {
+	if((variant >= MEM_COPY_VARIANTS) || (variants[variant] == NULL)) {
+		return -1;
+	}
+
+	selected = variant;
+	mem_copy = variants[variant];
+
+	return 0;
+}
+
+unsigned int mem_copy_selected() {
+	return selected;
+}
+
+const char *mem_copy_name(unsigned int variant) {
+	if(variant >= MEM_COPY_VARIANTS) {
+		return "none";
+	}
+	return names[variant];
+}
+
+unsigned int mem_copy_calibrate(void *dst, const void *src, unsigned long size, unsigned int reps) {
+	unsigned int variant, rep;
+	unsigned int best = selected;
+	unsigned long long start, elapsed;
+
+	for(variant = 0; variant < MEM_COPY_VARIANTS; variant++) {
+		cycles[variant] = 0;
+		/* byte stores are the access pattern being avoided, never worth timing on VRAM */
+		if((variants[variant] == NULL) || (variant == MEM_COPY_BYTE)) {
+			continue;
+		}
+
+		/* warm-up, so the first variant does not pay for page faults */
+		variants[variant](dst, src, size);
+
+		for(rep = 0; rep < reps; rep++) {
+			start = mem_read_cycles();
+			variants[variant](dst, src, size);
+			elapsed = mem_read_cycles() - start;
+			if((cycles[variant] == 0) || (elapsed < cycles[variant])) {
+				cycles[variant] = elapsed;
+			}
+		}
+
+		if((cycles[best] == 0) || (cycles[variant] < cycles[best])) {
+			best = variant;
+		}
+	}
+
+	mem_copy_select(best);
+
+	return best;
+}
+
+unsigned long long mem_copy_cycles(unsigned int variant) {
+	if(variant >= MEM_COPY_VARIANTS) {
+		return 0;
+	}
+	return cycles[variant];
+}
+
+void mem_fill(void *dst, uint32_t pattern, unsigned long size) {
+	unsigned char *d = dst;
+	const unsigned char *p = (const unsigned char *)&pattern;
+	unsigned int phase = 0;
+	uint64_t wide;
+	uint64_t *dq;
+
+	/* head: bytes up to a 64 bit boundary, keeping track of the pattern phase */
+	while(size && ((uintptr_t)d & (sizeof(uint64_t) - 1))) {
+		*d++ = p[phase];
+		phase = (phase + 1) & 3;
+		size--;
+	}
+
+	/* rotate the (little-endian) pattern so it starts at the current phase */
+	pattern = (phase == 0) ? pattern : ((pattern >> (8*phase)) | (pattern << (32 - 8*phase)));
+	wide = ((uint64_t)pattern << 32) | pattern;
+	p = (const unsigned char *)&pattern;
+
+	dq = (uint64_t *)d;
+	for(; size >= 4*sizeof(uint64_t); size -= 4*sizeof(uint64_t), dq += 4) {
+		dq[0] = wide;
+		dq[1] = wide;
+		dq[2] = wide;
+		dq[3] = wide;
+	}
+	for(; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+		*dq++ = wide;
+	}
+
+	d = (unsigned char *)dq;
+	for(phase = 0; size--; phase = (phase + 1) & 3) {
+		*d++ = p[phase];
+	}
+}
+
+static int block_equal(const unsigned char *a, const unsigned char *b) {
+#ifdef __SSE2__
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b))) == 0xFFFF;
+#else
+	uint64_t a0, a1, b0, b1;
+
+	memcpy(&a0, a, sizeof(uint64_t));
+	memcpy(&a1, a + sizeof(uint64_t), sizeof(uint64_t));
+	memcpy(&b0, b, sizeof(uint64_t));
+	memcpy(&b1, b + sizeof(uint64_t), sizeof(uint64_t));
+
+	return ((a0 ^ b0) | (a1 ^ b1)) == 0;
+#endif
+}
+
+unsigned long mem_equal_blocks(const void *a, const void *b, unsigned long blocks) {
+	const unsigned char *pa = a, *pb = b;
+	unsigned long count;
+
+	for(count = 0; (count < blocks) && block_equal(pa, pb); count++, pa += MEM_DIFF_BLOCK, pb += MEM_DIFF_BLOCK);
+
+	return count;
+}
+
+unsigned long mem_differ_blocks(const void *a, const void *b, unsigned long blocks) {
+	const unsigned char *pa = a, *pb = b;
+	unsigned long count;
+
+	for(count = 0; (count < blocks) && !block_equal(pa, pb); count++, pa += MEM_DIFF_BLOCK, pb += MEM_DIFF_BLOCK);
+
+	return count;
+}
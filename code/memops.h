@@ -0,0 +1,129 @@
+#ifndef MEMOPS_H_
+#define MEMOPS_H_
+
+#include "libraries.h"
+
+/** @defgroup memops memops
+ * @{
+ *
+ * Functions related to fast memory copies and fills, mainly for the video buffer and the video memory.
+ */
+
+/** @name Copy Variants */
+/**@{
+ *
+ * Available memory copy implementations
+ */
+enum {
+	MEM_COPY_BYTE,		/**< @brief one byte per store */
+	MEM_COPY_WORD,		/**< @brief one 32 bit word per store */
+	MEM_COPY_QWORD,		/**< @brief one 64 bit word per store */
+	MEM_COPY_STREAM,	/**< @brief 128 bit non-temporal stores (SSE2 builds only) */
+	MEM_COPY_LIBC,		/**< @brief the C library memcpy() */
+	MEM_COPY_VARIANTS	/**< @brief number of variants */
+};
+/** @} end of Copy Variants */
+
+#define MEM_DIFF_BLOCK	16	/**< @brief Bytes compared at once by mem_equal_blocks() and mem_differ_blocks() (an SSE2 register) */
+
+/**
+ * @brief Memory copy function type.
+ *
+ * @param dst destination address
+ * @param src source address
+ * @param size number of bytes to copy
+ */
+typedef void (*mem_copy_fn)(void *dst, const void *src, unsigned long size);
+
+/**
+ * @brief Currently selected memory copy function. Defaults to MEM_COPY_WORD.
+ */
+extern mem_copy_fn mem_copy;
+
+/**
+ * @brief Select the memory copy variant used by mem_copy.
+ *
+ * @param variant one of the copy variants
+ *
+ * @return 0 if success, -1 if the variant is not available in this build
+ */
+int mem_copy_select(unsigned int variant);
+/**
+ * @brief Get the currently selected memory copy variant.
+ *
+ * @return selected variant
+ */
+unsigned int mem_copy_selected();
+/**
+ * @brief Get the name of a memory copy variant.
+ *
+ * @param variant one of the copy variants
+ *
+ * @return variant name
+ */
+const char *mem_copy_name(unsigned int variant);
+/**
+ * @brief Times the available copy variants and selects the fastest.
+ *
+ * Each variant copies size bytes from src to dst reps times, the best run being kept.
+ * MEM_COPY_BYTE is not timed.
+ *
+ * @param dst destination address (usually the video memory)
+ * @param src source address
+ * @param size number of bytes to copy
+ * @param reps number of repetitions per variant
+ *
+ * @return selected variant
+ */
+unsigned int mem_copy_calibrate(void *dst, const void *src, unsigned long size, unsigned int reps);
+/**
+ * @brief Get the best time measured for a variant by the last mem_copy_calibrate() call.
+ *
+ * @param variant one of the copy variants
+ *
+ * @return CPU cycles, 0 if the variant was not measured
+ */
+unsigned long long mem_copy_cycles(unsigned int variant);
+/**
+ * @brief Read the CPU's time stamp counter, the clock mem_copy_calibrate() times with.
+ *
+ * @return CPU cycles (clock() ticks where there is no time stamp counter)
+ */
+unsigned long long mem_read_cycles();
+
+/**
+ * @brief Fill memory with a repeated 32 bit pattern, using the widest stores available.
+ *
+ * The pattern is written in memory order starting at dst, so a byte value
+ * must be replicated to all four bytes of the pattern.
+ *
+ * @param dst destination address
+ * @param pattern 32 bit pattern to repeat
+ * @param size number of bytes to fill
+ */
+void mem_fill(void *dst, uint32_t pattern, unsigned long size);
+
+/**
+ * @brief Count the leading MEM_DIFF_BLOCK byte blocks that are equal in two buffers.
+ *
+ * @param a first buffer
+ * @param b second buffer
+ * @param blocks number of blocks to compare at most
+ *
+ * @return number of equal blocks before the first different one
+ */
+unsigned long mem_equal_blocks(const void *a, const void *b, unsigned long blocks);
+/**
+ * @brief Count the leading MEM_DIFF_BLOCK byte blocks that differ in two buffers.
+ *
+ * @param a first buffer
+ * @param b second buffer
+ * @param blocks number of blocks to compare at most
+ *
+ * @return number of different blocks before the first equal one
+ */
+unsigned long mem_differ_blocks(const void *a, const void *b, unsigned long blocks);
+
+/** @} end of memops */
+
+#endif /* MEMOPS_H_ */
@@ -9,11 +9,13 @@
 #include "i8042.h"
 #include "game.h"
 
+static int mouse_hook_id;	/**< @brief Hook id the kernel returned, which sys_irqrmpolicy() takes */
+
 int mouse_subscribe_int(unsigned int mouse_id) {
 
-	unsigned int hook_id = mouse_id;
+	mouse_hook_id = mouse_id;
 
-	if (sys_irqsetpolicy(MOUSE_IRQ, IRQ_REENABLE | IRQ_EXCLUSIVE, &hook_id) != OK) {
+	if (sys_irqsetpolicy(MOUSE_IRQ, IRQ_REENABLE | IRQ_EXCLUSIVE, &mouse_hook_id) != OK) {
 		return -1;
 
 	}
@@ -23,9 +25,7 @@ int mouse_subscribe_int(unsigned int mouse_id) {
 
 int mouse_unsubscribe_int(unsigned int mouse_id) {
 
-	unsigned int hook_id = mouse_id;
-
-	if (!sys_irqrmpolicy(&hook_id)) {
+	if (sys_irqrmpolicy(&mouse_hook_id) != OK) {
 		return -1;
 
 	}
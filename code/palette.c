@@ -0,0 +1,227 @@
+/*
+ * palette.c
+ *
+ * DAC palette and palette animation.
+ */
+
+#include "palette.h"
+#include "vbe.h"
+
+#define VGA_DAC_READ_INDEX	0x3C7	/**< @brief Index of the next entry read from VGA_DAC_DATA */
+#define VGA_DAC_WRITE_INDEX	0x3C8	/**< @brief Index of the next entry written to VGA_DAC_DATA */
+#define VGA_DAC_DATA		0x3C9	/**< @brief Red, green and blue of an entry, then the next one */
+#define DAC_WIDTH			6		/**< @brief Bits per channel of the DAC */
+
+static int indexed = 0;					/**< @brief The mode shows colors through the DAC */
+static int vbe_palette = 1;				/**< @brief VBE function 0x09 works on this adapter */
+static unsigned char table[PIXFMT_COLORS * 4];	/**< @brief Entries in the VBE layout: blue, green, red, unused */
+
+static palette_t base;					/**< @brief Palette loaded by palette_load() */
+static palette_t shown;					/**< @brief Palette in the DAC */
+static palette_t from;					/**< @brief Colors at the start of the effect */
+static palette_t to;					/**< @brief Colors at the end of the effect */
+static unsigned int step = 0;			/**< @brief Steps of the effect done */
+static unsigned int steps = 0;			/**< @brief Steps of the effect, 0 if none is running */
+static int returning = 0;				/**< @brief The effect goes back to the loaded palette once it reaches to */
+
+/**
+ * @brief Colors num/den of the way from palette a to palette b.
+ */
+static void blend(palette_t *out, const palette_t *a, const palette_t *b, unsigned int num, unsigned int den) {
+	unsigned int i, c;
+
+	for(i = 0; i < PIXFMT_COLORS; i++) {
+		for(c = 0; c < 3; c++) {
+			out->rgb[i][c] = a->rgb[i][c] + ((int)b->rgb[i][c] - (int)a->rgb[i][c]) * (int)num / (int)den;
+		}
+	}
+}
+
+/**
+ * @brief Show a palette: in the DAC, or in the conversion of a direct color mode.
+ */
+static int show(const palette_t *palette) {
+	if(!indexed) {
+		pixfmt_set_palette(palette->rgb);
+		return 0;
+	}
+	shown = *palette;
+	return palette_set(0, PIXFMT_COLORS, palette->rgb);
+}
+
+int palette_init(unsigned int is_indexed) {
+	palette_t defaults;
+	unsigned int i;
+
+	indexed = is_indexed;
+	steps = 0;
+
+	if(indexed) {
+		/* a DAC left in 8 bit mode shows 6 bit colors about four times darker */
+		vbe_set_dac_width(DAC_WIDTH);
+		/* the low memory table is set up once, not on every palette write */
+		if(vbe_palette_init() != 0) {
+			vbe_palette = 0;
+		}
+	}
+
+	for(i = 0; i < PIXFMT_COLORS; i++) {
+		pixfmt_palette_entry(i, defaults.rgb[i]);
+	}
+
+	return palette_load(&defaults);
+}
+
+int palette_set(unsigned int first, unsigned int count, const unsigned char rgb[][3]) {
+	unsigned long i, c;
+
+	if(!indexed || (first + count > PIXFMT_COLORS)) {
+		return -1;
+	}
+
+	if(vbe_palette) {
+		for(i = 0; i < count; i++) {
+			table[i*4] = rgb[i][2];
+			table[i*4 + 1] = rgb[i][1];
+			table[i*4 + 2] = rgb[i][0];
+			table[i*4 + 3] = 0;
+		}
+		if(vbe_set_palette(first, count, table) == 0) {
+			return 0;
+		}
+		/* VBE before 2.0, the VGA ports are always there */
+		vbe_palette = 0;
+	}
+
+	if(sys_outb(VGA_DAC_WRITE_INDEX, first) != OK) {
+		return -1;
+	}
+	for(i = 0; i < count; i++) {
+		for(c = 0; c < 3; c++) {
+			if(sys_outb(VGA_DAC_DATA, rgb[i][c]) != OK) {
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int palette_get(unsigned int first, unsigned int count, unsigned char rgb[][3]) {
+	unsigned long i, c, value;
+
+	if(!indexed || (first + count > PIXFMT_COLORS)) {
+		return -1;
+	}
+
+	if(vbe_palette && (vbe_get_palette(first, count, table) == 0)) {
+		for(i = 0; i < count; i++) {
+			rgb[i][0] = table[i*4 + 2];
+			rgb[i][1] = table[i*4 + 1];
+			rgb[i][2] = table[i*4];
+		}
+		return 0;
+	}
+
+	if(sys_outb(VGA_DAC_READ_INDEX, first) != OK) {
+		return -1;
+	}
+	for(i = 0; i < count; i++) {
+		for(c = 0; c < 3; c++) {
+			if(sys_inb(VGA_DAC_DATA, &value) != OK) {
+				return -1;
+			}
+			rgb[i][c] = value & 0x3F;
+		}
+	}
+
+	return 0;
+}
+
+int palette_load(const palette_t *palette) {
+	base = *palette;
+	steps = 0;
+	return show(&base);
+}
+
+const palette_t *palette_get_base() {
+	return &base;
+}
+
+/**
+ * @brief Start an effect from the colors shown.
+ */
+static int start(const palette_t *target, unsigned int ticks, int back) {
+	if(!indexed) {
+		return -1;
+	}
+
+	from = shown;
+	to = *target;
+	step = 0;
+	steps = (ticks > 0) ? ticks : 1;
+	returning = back;
+
+	return 0;
+}
+
+int palette_fade_out(unsigned int ticks) {
+	palette_t black;
+
+	memset(&black, 0, sizeof(black));
+	return start(&black, ticks, 0);
+}
+
+int palette_fade_in(unsigned int ticks) {
+	return start(&base, ticks, 0);
+}
+
+int palette_flash(unsigned int color, unsigned int ticks) {
+	palette_t target;
+	unsigned int i;
+
+	if(color >= PIXFMT_COLORS) {
+		return -1;
+	}
+
+	for(i = 0; i < PIXFMT_COLORS; i++) {
+		memcpy(target.rgb[i], base.rgb[color], 3);
+	}
+	blend(&target, &base, &target, PALETTE_FLASH_PERCENT, 100);
+
+	/* half of the ticks there, half back */
+	return start(&target, ticks / 2, 1);
+}
+
+int palette_tick() {
+	palette_t colors;
+
+	if(steps == 0) {
+		return 0;
+	}
+
+	step++;
+	blend(&colors, &from, &to, step, steps);
+	if(show(&colors) != 0) {
+		steps = 0;
+		return -1;
+	}
+
+	if(step == steps) {
+		if(!returning) {
+			steps = 0;
+			return 0;
+		}
+		from = to;
+		to = base;
+		step = 0;
+		returning = 0;
+	}
+
+	return 1;
+}
+
+int palette_reset() {
+	steps = 0;
+	return show(&base);
+}
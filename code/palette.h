@@ -0,0 +1,120 @@
+#ifndef PALETTE_H_
+#define PALETTE_H_
+
+#include "libraries.h"
+#include "pixfmt.h"
+
+/** @defgroup palette palette
+ * @{
+ *
+ * Palette of the indexed colors: loading the DAC and palette animation
+ * (fades and flashes), which changes every color on screen without drawing.
+ *
+ * Effects need an indexed mode; in direct color modes the palette only sets
+ * how colors are converted to pixels.
+ */
+
+#define PALETTE_FADE_TICKS		30	/**< @brief Timer ticks of a fade */
+#define PALETTE_FLASH_TICKS		12	/**< @brief Timer ticks of a flash, there and back */
+#define PALETTE_FLASH_PERCENT	50	/**< @brief How far a flash takes every color towards its own */
+
+/** @name Palette */
+/**@{
+ *
+ * Color of every index, 6 bits per channel
+ */
+typedef struct {
+	unsigned char rgb[PIXFMT_COLORS][3];	/**< @brief red, green and blue of each index */
+} palette_t;
+/** @} end of Palette */
+
+/**
+ * @brief Load the default VGA palette, right after a mode is set.
+ *
+ * The DAC is set to 6 bits per channel and loaded with every entry, so the
+ * colors do not depend on what the adapter had before.
+ *
+ * @param indexed the mode is an indexed one, shown through the DAC
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int palette_init(unsigned int indexed);
+/**
+ * @brief Load entries into the DAC.
+ *
+ * Uses VBE function 0x09, or the VGA DAC ports if the adapter does not support it.
+ *
+ * @param first index of the first entry
+ * @param count number of entries
+ * @param rgb count colors, 6 bits per channel
+ *
+ * @return 0 if success, -1 otherwise (e.g. a direct color mode)
+ */
+int palette_set(unsigned int first, unsigned int count, const unsigned char rgb[][3]);
+/**
+ * @brief Read entries from the DAC.
+ *
+ * @param first index of the first entry
+ * @param count number of entries
+ * @param rgb where to store count colors, 6 bits per channel
+ *
+ * @return 0 if success, -1 otherwise (e.g. a direct color mode)
+ */
+int palette_get(unsigned int first, unsigned int count, unsigned char rgb[][3]);
+/**
+ * @brief Make a palette the one effects start from and return to, and show it.
+ *
+ * Stops any running effect.
+ *
+ * @param palette palette to load
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int palette_load(const palette_t *palette);
+/**
+ * @brief Get the palette loaded with palette_load().
+ *
+ * @return pointer to the palette
+ */
+const palette_t *palette_get_base();
+/**
+ * @brief Start fading every color to black.
+ *
+ * @param ticks duration, in calls to palette_tick()
+ *
+ * @return 0 if success, -1 otherwise (e.g. a direct color mode)
+ */
+int palette_fade_out(unsigned int ticks);
+/**
+ * @brief Start fading from the colors shown to the loaded palette.
+ *
+ * @param ticks duration, in calls to palette_tick()
+ *
+ * @return 0 if success, -1 otherwise (e.g. a direct color mode)
+ */
+int palette_fade_in(unsigned int ticks);
+/**
+ * @brief Start a flash: every color is taken towards a color and back.
+ *
+ * @param color index whose loaded color is flashed
+ * @param ticks duration, there and back, in calls to palette_tick()
+ *
+ * @return 0 if success, -1 otherwise (e.g. a direct color mode)
+ */
+int palette_flash(unsigned int color, unsigned int ticks);
+/**
+ * @brief Advance the running effect by one step, once per timer tick.
+ *
+ * @return 1 if the effect has more steps, 0 if no effect is running, -1 on error
+ */
+int palette_tick();
+/**
+ * @brief Stop any running effect and show the loaded palette.
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int palette_reset();
+
+/** @} end of palette */
+
+#endif /* PALETTE_H_ */
@@ -0,0 +1,214 @@
+/*
+ * pixfmt.c
+ *
+ * Pixel formats of the VBE modes.
+ */
+
+#include "pixfmt.h"
+#include "memops.h"
+
+/** @brief Default VGA palette, 6 bits per channel */
+static const unsigned char vga_palette[PIXFMT_COLORS][3] = {
+	{ 0, 0, 0}, { 0, 0,42}, { 0,42, 0}, { 0,42,42}, {42, 0, 0}, {42, 0,42}, {42,21, 0}, {42,42,42},	/*   0 */
+	{21,21,21}, {21,21,63}, {21,63,21}, {21,63,63}, {63,21,21}, {63,21,63}, {63,63,21}, {63,63,63},	/*   8 */
+	{ 0, 0, 0}, { 5, 5, 5}, { 8, 8, 8}, {11,11,11}, {14,14,14}, {17,17,17}, {20,20,20}, {24,24,24},	/*  16 */
+	{28,28,28}, {32,32,32}, {36,36,36}, {40,40,40}, {45,45,45}, {50,50,50}, {56,56,56}, {63,63,63},	/*  24 */
+	{ 0, 0,63}, {16, 0,63}, {31, 0,63}, {47, 0,63}, {63, 0,63}, {63, 0,47}, {63, 0,31}, {63, 0,16},	/*  32 */
+	{63, 0, 0}, {63,16, 0}, {63,31, 0}, {63,47, 0}, {63,63, 0}, {47,63, 0}, {31,63, 0}, {16,63, 0},	/*  40 */
+	{ 0,63, 0}, { 0,63,16}, { 0,63,31}, { 0,63,47}, { 0,63,63}, { 0,47,63}, { 0,31,63}, { 0,16,63},	/*  48 */
+	{31,31,63}, {39,31,63}, {47,31,63}, {55,31,63}, {63,31,63}, {63,31,55}, {63,31,47}, {63,31,39},	/*  56 */
+	{63,31,31}, {63,39,31}, {63,47,31}, {63,55,31}, {63,63,31}, {55,63,31}, {47,63,31}, {39,63,31},	/*  64 */
+	{31,63,31}, {31,63,39}, {31,63,47}, {31,63,55}, {31,63,63}, {31,55,63}, {31,47,63}, {31,39,63},	/*  72 */
+	{45,45,63}, {49,45,63}, {54,45,63}, {58,45,63}, {63,45,63}, {63,45,58}, {63,45,54}, {63,45,49},	/*  80 */
+	{63,45,45}, {63,49,45}, {63,54,45}, {63,58,45}, {63,63,45}, {58,63,45}, {54,63,45}, {49,63,45},	/*  88 */
+	{45,63,45}, {45,63,49}, {45,63,54}, {45,63,58}, {45,63,63}, {45,58,63}, {45,54,63}, {45,49,63},	/*  96 */
+	{ 0, 0,28}, { 7, 0,28}, {14, 0,28}, {21, 0,28}, {28, 0,28}, {28, 0,21}, {28, 0,14}, {28, 0, 7},	/* 104 */
+	{28, 0, 0}, {28, 7, 0}, {28,14, 0}, {28,21, 0}, {28,28, 0}, {21,28, 0}, {14,28, 0}, { 7,28, 0},	/* 112 */
+	{ 0,28, 0}, { 0,28, 7}, { 0,28,14}, { 0,28,21}, { 0,28,28}, { 0,21,28}, { 0,14,28}, { 0, 7,28},	/* 120 */
+	{14,14,28}, {17,14,28}, {21,14,28}, {24,14,28}, {28,14,28}, {28,14,24}, {28,14,21}, {28,14,17},	/* 128 */
+	{28,14,14}, {28,17,14}, {28,21,14}, {28,24,14}, {28,28,14}, {24,28,14}, {21,28,14}, {17,28,14},	/* 136 */
+	{14,28,14}, {14,28,17}, {14,28,21}, {14,28,24}, {14,28,28}, {14,24,28}, {14,21,28}, {14,17,28},	/* 144 */
+	{20,20,28}, {22,20,28}, {24,20,28}, {26,20,28}, {28,20,28}, {28,20,26}, {28,20,24}, {28,20,22},	/* 152 */
+	{28,20,20}, {28,22,20}, {28,24,20}, {28,26,20}, {28,28,20}, {26,28,20}, {24,28,20}, {22,28,20},	/* 160 */
+	{20,28,20}, {20,28,22}, {20,28,24}, {20,28,26}, {20,28,28}, {20,26,28}, {20,24,28}, {20,22,28},	/* 168 */
+	{ 0, 0,16}, { 4, 0,16}, { 8, 0,16}, {12, 0,16}, {16, 0,16}, {16, 0,12}, {16, 0, 8}, {16, 0, 4},	/* 176 */
+	{16, 0, 0}, {16, 4, 0}, {16, 8, 0}, {16,12, 0}, {16,16, 0}, {12,16, 0}, { 8,16, 0}, { 4,16, 0},	/* 184 */
+	{ 0,16, 0}, { 0,16, 4}, { 0,16, 8}, { 0,16,12}, { 0,16,16}, { 0,12,16}, { 0, 8,16}, { 0, 4,16},	/* 192 */
+	{ 8, 8,16}, {10, 8,16}, {12, 8,16}, {14, 8,16}, {16, 8,16}, {16, 8,14}, {16, 8,12}, {16, 8,10},	/* 200 */
+	{16, 8, 8}, {16,10, 8}, {16,12, 8}, {16,14, 8}, {16,16, 8}, {14,16, 8}, {12,16, 8}, {10,16, 8},	/* 208 */
+	{ 8,16, 8}, { 8,16,10}, { 8,16,12}, { 8,16,14}, { 8,16,16}, { 8,14,16}, { 8,12,16}, { 8,10,16},	/* 216 */
+	{11,11,16}, {12,11,16}, {13,11,16}, {15,11,16}, {16,11,16}, {16,11,15}, {16,11,13}, {16,11,12},	/* 224 */
+	{16,11,11}, {16,12,11}, {16,13,11}, {16,15,11}, {16,16,11}, {15,16,11}, {13,16,11}, {12,16,11},	/* 232 */
+	{11,16,11}, {11,16,12}, {11,16,13}, {11,16,15}, {11,16,16}, {11,15,16}, {11,13,16}, {11,12,16},	/* 240 */
+	{ 0, 0, 0}, { 0, 0, 0}, { 0, 0, 0}, { 0, 0, 0}, { 0, 0, 0}, { 0, 0, 0}, { 0, 0, 0}, { 0, 0, 0},	/* 248 */
+};
+
+static unsigned char palette[PIXFMT_COLORS][3];	/**< @brief Palette set with pixfmt_set_palette() */
+static const unsigned char (*colors)[3] = vga_palette;	/**< @brief Palette direct color pixels are converted through */
+static pixfmt_layout_t channels;			/**< @brief Channel layout of the direct color mode */
+static uint32_t color_map[PIXFMT_COLORS];	/**< @brief Pixel of each indexed color, when direct is set */
+static int direct = 0;						/**< @brief Colors are converted through color_map[] */
+static unsigned long version = 0;			/**< @brief Incremented whenever the conversion changes */
+
+/** @name Pixel stores */
+/**@{
+ *
+ * Store and load of one pixel of each size, little-endian
+ */
+#define STORE_8(p, c)	(*(uint8_t *)(p) = (uint8_t)(c))
+#define LOAD_8(p)		(*(const uint8_t *)(p))
+#define STORE_16(p, c)	(*(uint16_t *)(p) = (uint16_t)(c))
+#define LOAD_16(p)		(*(const uint16_t *)(p))
+#define STORE_24(p, c)	((p)[0] = (uint8_t)(c), (p)[1] = (uint8_t)((c) >> 8), (p)[2] = (uint8_t)((c) >> 16))
+#define LOAD_24(p)		((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | ((uint32_t)(p)[2] << 16))
+#define STORE_32(p, c)	(*(uint32_t *)(p) = (uint32_t)(c))
+#define LOAD_32(p)		(*(const uint32_t *)(p))
+#define STORE_HEAT(p, c)	(*(uint8_t *)(p) += (*(uint8_t *)(p) != 0xFF))
+#define LOAD_HEAT(p)		(*(const uint8_t *)(p))
+/**@} end of Pixel stores */
+
+/** @name Spans */
+/**@{
+ *
+ * Sizes which divide 4 bytes are filled with wide stores of a repeated pattern
+ */
+static void span_8(unsigned char *dst, uint32_t pixel, unsigned long count) {
+	mem_fill(dst, (pixel & 0xFF) * 0x01010101, count);
+}
+
+static void span_16(unsigned char *dst, uint32_t pixel, unsigned long count) {
+	mem_fill(dst, (pixel & 0xFFFF) * 0x00010001, count * 2);
+}
+
+static void span_24(unsigned char *dst, uint32_t pixel, unsigned long count) {
+	for(; count > 0; count--, dst += 3) {
+		STORE_24(dst, pixel);
+	}
+}
+
+static void span_32(unsigned char *dst, uint32_t pixel, unsigned long count) {
+	mem_fill(dst, pixel, count * 4);
+}
+
+static void span_heat(unsigned char *dst, uint32_t pixel, unsigned long count) {
+	for(; count > 0; count--, dst++) {
+		STORE_HEAT(dst, pixel);
+	}
+}
+/**@} end of Spans */
+
+/**
+ * @brief Define the writers of a pixel size and its pixfmt_t.
+ *
+ * Every loop is expanded with the size's own store, so there is no per-pixel format check.
+ */
+#define PIXFMT_DEFINE(name, bits, bytes, STORE, LOAD) \
+static void put_##name(unsigned char *dst, uint32_t pixel) { \
+	STORE(dst, pixel); \
+} \
+static uint32_t get_##name(const unsigned char *src) { \
+	return LOAD(src); \
+} \
+static void step_##name(unsigned char *dst, uint32_t pixel, unsigned long count, long stride) { \
+	for(; count > 0; count--, dst += stride) { \
+		STORE(dst, pixel); \
+	} \
+} \
+static void line_##name(unsigned char *dst, uint32_t pixel, unsigned long count, long err, long err_step, long err_max, long major_stride, long minor_stride) { \
+	for(; count > 0; count--, dst += major_stride) { \
+		STORE(dst, pixel); \
+		err += err_step; \
+		if(err >= err_max) { \
+			err -= err_max; \
+			dst += minor_stride; \
+		} \
+	} \
+} \
+const pixfmt_t pixfmt_##name = { bits, bytes, put_##name, get_##name, span_##name, step_##name, line_##name };
+
+PIXFMT_DEFINE(8, 8, 1, STORE_8, LOAD_8)
+PIXFMT_DEFINE(16, 16, 2, STORE_16, LOAD_16)
+PIXFMT_DEFINE(24, 24, 3, STORE_24, LOAD_24)
+PIXFMT_DEFINE(32, 32, 4, STORE_32, LOAD_32)
+PIXFMT_DEFINE(heat, 8, 1, STORE_HEAT, LOAD_HEAT)
+
+const pixfmt_t *pixfmt_get(unsigned int bits_per_pixel) {
+	switch(bits_per_pixel) {
+	case 8:
+		return &pixfmt_8;
+	case 15:
+	case 16:
+		return &pixfmt_16;
+	case 24:
+		return &pixfmt_24;
+	case 32:
+		return &pixfmt_32;
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * @brief Scale a 6 bit channel to size bits and move it to its position.
+ */
+static uint32_t channel(unsigned char value, unsigned char size, unsigned char position) {
+	uint32_t max = (1UL << size) - 1;
+
+	return ((value * max + 31) / 63) << position;
+}
+
+/**
+ * @brief Convert every indexed color through the palette to the channel layout.
+ */
+static void build_map() {
+	unsigned int color;
+
+	for(color = 0; color < PIXFMT_COLORS; color++) {
+		color_map[color] = channel(colors[color][0], channels.red_size, channels.red_position) |
+				channel(colors[color][1], channels.green_size, channels.green_position) |
+				channel(colors[color][2], channels.blue_size, channels.blue_position);
+	}
+}
+
+void pixfmt_set_layout(const pixfmt_layout_t *layout) {
+	version++;
+
+	if(layout == NULL) {
+		direct = 0;
+		return;
+	}
+
+	channels = *layout;
+	build_map();
+	direct = 1;
+}
+
+void pixfmt_set_palette(const unsigned char rgb[][3]) {
+	if(rgb == NULL) {
+		colors = vga_palette;
+	}
+	else {
+		memcpy(palette, rgb, sizeof(palette));
+		colors = palette;
+	}
+
+	/* indexed modes show the palette through the DAC, their pixels stay the same */
+	if(direct) {
+		version++;
+		build_map();
+	}
+}
+
+uint32_t pixfmt_map(unsigned int color) {
+	return direct ? color_map[color & 0xFF] : (color & 0xFF);
+}
+
+unsigned long pixfmt_get_version() {
+	return version;
+}
+
+void pixfmt_palette_entry(unsigned int color, unsigned char rgb[3]) {
+	rgb[0] = vga_palette[color & 0xFF][0];
+	rgb[1] = vga_palette[color & 0xFF][1];
+	rgb[2] = vga_palette[color & 0xFF][2];
+}
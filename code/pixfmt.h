@@ -0,0 +1,103 @@
+#ifndef PIXFMT_H_
+#define PIXFMT_H_
+
+#include "libraries.h"
+
+/** @defgroup pixfmt pixfmt
+ * @{
+ *
+ * Pixel formats of the VBE modes: a table of writers specialized for each
+ * pixel size, and the conversion of the game's indexed colors to pixels.
+ */
+
+#define PIXFMT_COLORS	256	/**< @brief Number of indexed colors */
+
+/** @name Pixel Format */
+/**@{
+ *
+ * Writers of one pixel size; pixels are in the format's own layout, as returned by pixfmt_map()
+ */
+typedef struct {
+	unsigned int bits_per_pixel;	/**< @brief bits per pixel of the format */
+	unsigned int bytes_per_pixel;	/**< @brief bytes per pixel of the format */
+	void (*put)(unsigned char *dst, uint32_t pixel);	/**< @brief write one pixel */
+	uint32_t (*get)(const unsigned char *src);			/**< @brief read one pixel */
+	void (*span)(unsigned char *dst, uint32_t pixel, unsigned long count);	/**< @brief write count consecutive pixels */
+	void (*step)(unsigned char *dst, uint32_t pixel, unsigned long count, long stride);	/**< @brief write count pixels, stride bytes apart */
+	void (*line)(unsigned char *dst, uint32_t pixel, unsigned long count, long err, long err_step, long err_max, long major_stride, long minor_stride);	/**< @brief write count Bresenham steps; the minor axis advances each time err reaches err_max */
+} pixfmt_t;
+/** @} end of Pixel Format */
+
+/** @name Channel Layout */
+/**@{
+ *
+ * Position of the color channels of a direct color pixel, from the VBE mode info
+ */
+typedef struct {
+	unsigned char red_size;			/**< @brief bits of red */
+	unsigned char red_position;		/**< @brief bit position of the lsb of red */
+	unsigned char green_size;		/**< @brief bits of green */
+	unsigned char green_position;	/**< @brief bit position of the lsb of green */
+	unsigned char blue_size;		/**< @brief bits of blue */
+	unsigned char blue_position;	/**< @brief bit position of the lsb of blue */
+} pixfmt_layout_t;
+/** @} end of Channel Layout */
+
+extern const pixfmt_t pixfmt_8;		/**< @brief 8 bpp, indexed */
+extern const pixfmt_t pixfmt_16;	/**< @brief 15 and 16 bpp */
+extern const pixfmt_t pixfmt_24;	/**< @brief 24 bpp, packed */
+extern const pixfmt_t pixfmt_32;	/**< @brief 32 bpp */
+extern const pixfmt_t pixfmt_heat;	/**< @brief 8 bpp write counters: every write adds one, up to 255, whatever the pixel */
+
+/**
+ * @brief Get the writers for a number of bits per pixel.
+ *
+ * @param bits_per_pixel bits per pixel of the mode
+ *
+ * @return the pixel format, NULL if there is none for bits_per_pixel
+ */
+const pixfmt_t *pixfmt_get(unsigned int bits_per_pixel);
+/**
+ * @brief Set how indexed colors are converted to pixels.
+ *
+ * Each indexed color is converted through the palette set with
+ * pixfmt_set_palette(), the default VGA palette until then.
+ *
+ * @param layout channel layout of a direct color mode, NULL for an indexed mode
+ */
+void pixfmt_set_layout(const pixfmt_layout_t *layout);
+/**
+ * @brief Set the palette direct color modes convert indexed colors through.
+ *
+ * Changes pixfmt_get_version() in a direct color mode; indexed modes keep their pixels.
+ *
+ * @param rgb PIXFMT_COLORS colors, 6 bits per channel; NULL for the default VGA palette
+ */
+void pixfmt_set_palette(const unsigned char rgb[][3]);
+/**
+ * @brief Convert an indexed color to a pixel of the current layout.
+ *
+ * @param color indexed color, only the low 8 bits are used
+ *
+ * @return pixel value
+ */
+uint32_t pixfmt_map(unsigned int color);
+/**
+ * @brief Get a number that changes whenever pixfmt_map() may start returning other pixels.
+ *
+ * Pixels converted earlier, e.g. kept in a surface, are stale once it changes.
+ *
+ * @return conversion version
+ */
+unsigned long pixfmt_get_version();
+/**
+ * @brief Get a color of the default VGA palette.
+ *
+ * @param color indexed color, only the low 8 bits are used
+ * @param rgb red, green and blue, 6 bits each
+ */
+void pixfmt_palette_entry(unsigned int color, unsigned char rgb[3]);
+
+/** @} end of pixfmt */
+
+#endif /* PIXFMT_H_ */
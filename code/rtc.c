@@ -42,7 +42,7 @@ void wait_valid_rtc(void) {
 
 char * rtc_get_week_day(RTC game_rtc) {
 
-	char * str = malloc(4);
+	char * str = malloc(5);
 
 	switch(parseBCD(game_rtc.data[RTC_DAY_WEEK], BCDlength)) {
 	case 1:
@@ -76,7 +76,7 @@ char * rtc_get_week_day(RTC game_rtc) {
 }
 
 char * rtc_get_month(RTC game_rtc) {
-	char * str = malloc(4);
+	char * str = malloc(5);
 	switch(parseBCD(game_rtc.data[RTC_MONTH], BCDlength)) {
 	case 1:
 		strcpy(str, "jan.");
@@ -143,7 +143,7 @@ int rtc_get_seconds(RTC game_rtc) {
 }
 
 RTC rtc_get_date(void) {
-	unsigned int i,index;
+	unsigned int i, index = 0;
 	int length = 1;
 	unsigned long register_data[9];
 
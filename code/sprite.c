@@ -0,0 +1,152 @@
+/*
+ * sprite.c
+ *
+ * Compiled character-art sprites.
+ */
+
+#include "sprite.h"
+
+/**
+ * @brief Collect the opaque runs of the scaled sprite.
+ *
+ * @return number of runs, -1 if the art has an invalid char; runs is only written to if it is not NULL
+ */
+static int collect_runs(const SPRITE *sprite, const char *art, unsigned int width, unsigned int height,
+		unsigned int pitch, unsigned int scale, vg_run_t *runs) {
+	unsigned int bytes = vg_get_bytes_per_pixel();
+	unsigned int x, y, start, copy;
+	const char *line;
+	int count = 0;
+
+	for(y = 0; y < height; y++) {
+		line = art + y * pitch;
+		for(x = 0; x < width; ) {
+			if(line[x] == ' ') {
+				x++;
+				continue;
+			}
+			if((line[x] < '0') || (line[x] > '9')) {
+				return -1;
+			}
+			for(start = x; (x < width) && (line[x] != ' '); x++);
+			if(runs != NULL) {
+				for(copy = 0; copy < scale; copy++, count++) {
+					runs[count].x = start * scale;
+					runs[count].y = y * scale + copy;
+					runs[count].len = (x - start) * scale;
+					runs[count].pixels = sprite->pixels + (y * width + start) * scale * bytes;
+				}
+			}
+			else {
+				count += scale;
+			}
+		}
+	}
+
+	return count;
+}
+
+SPRITE *sprite_compile(const char *art, unsigned int width, unsigned int height, unsigned int pitch,
+		unsigned int scale, const unsigned int palette[], unsigned int palette_size) {
+	unsigned int bytes = vg_get_bytes_per_pixel();
+	unsigned int x, y, copy, byte, color;
+	unsigned char *pixel;
+	SPRITE *sprite;
+	int count;
+
+	if(scale == 0) {
+		return NULL;
+	}
+	/* the runs are in buffer pixels */
+	scale = (scale > vg_get_render_scale()) ? scale / vg_get_render_scale() : 1;
+	if((count = collect_runs(NULL, art, width, height, pitch, scale, NULL)) == -1) {
+		return NULL;
+	}
+
+	if((sprite = malloc(sizeof(SPRITE))) == NULL) {
+		return NULL;
+	}
+
+	sprite->image.width = width * scale;
+	sprite->image.height = height * scale;
+	sprite->image.count = count;
+	sprite->image.runs = malloc(sizeof(vg_run_t) * (count + 1));
+	sprite->pixels = malloc(width * scale * height * bytes);
+
+	if((sprite->image.runs == NULL) || (sprite->pixels == NULL)) {
+		sprite_destroy(sprite);
+		return NULL;
+	}
+
+	/* resolve each source row once, already stretched horizontally */
+	pixel = sprite->pixels;
+	for(y = 0; y < height; y++) {
+		for(x = 0; x < width; x++) {
+			color = 0;
+			if(art[y * pitch + x] != ' ') {
+				if((unsigned int)(art[y * pitch + x] - '0') >= palette_size) {
+					sprite_destroy(sprite);
+					return NULL;
+				}
+				color = vg_map_color(palette[art[y * pitch + x] - '0']);
+			}
+			for(copy = 0; copy < scale; copy++) {
+				for(byte = 0; byte < bytes; byte++) {
+					*pixel++ = (color >> (8 * byte)) & 0xFF;
+				}
+			}
+		}
+	}
+
+	collect_runs(sprite, art, width, height, pitch, scale, sprite->image.runs);
+
+	return sprite;
+}
+
+void sprite_destroy(SPRITE *sprite) {
+	if(sprite != NULL) {
+		free(sprite->image.runs);
+		free(sprite->pixels);
+		free(sprite);
+	}
+}
+
+int sprite_draw(const SPRITE *sprite, int x, int y) {
+	if(sprite == NULL) {
+		return -1;
+	}
+	return vg_draw_runs(x, y, &sprite->image);
+}
+
+int sprite_overlay_show(SPRITE_OVERLAY *overlay, int x, int y) {
+	if(overlay->sprite == NULL) {
+		return -1;
+	}
+	if(overlay->under == NULL) {
+		overlay->under = vg_surface_create(overlay->sprite->image.width * vg_get_render_scale(),
+				overlay->sprite->image.height * vg_get_render_scale());
+		if(overlay->under == NULL) {
+			return -1;
+		}
+	}
+
+	sprite_overlay_hide(overlay);
+
+	vg_read_surface(overlay->under, x, y);
+	overlay->x = x;
+	overlay->y = y;
+	overlay->visible = 1;
+
+	return sprite_draw(overlay->sprite, x, y);
+}
+
+void sprite_overlay_hide(SPRITE_OVERLAY *overlay) {
+	if(overlay->visible) {
+		vg_blit_surface(overlay->under, overlay->x, overlay->y);
+		overlay->visible = 0;
+	}
+}
+
+void sprite_overlay_drop(SPRITE_OVERLAY *overlay) {
+	overlay->visible = 0;
+}
@@ -0,0 +1,101 @@
+#ifndef SPRITE_H_
+#define SPRITE_H_
+
+#include "libraries.h"
+#include "video_gr.h"
+
+/** @defgroup sprite sprite
+ * @{
+ *
+ * Character-art sprites compiled to opaque runs of palette-resolved pixels.
+ */
+
+/** @name Sprite */
+/**@{
+ *
+ * Compiled sprite
+ */
+typedef struct {
+	vg_runs_t image;		/**< @brief opaque runs of the scaled sprite */
+	unsigned char *pixels;	/**< @brief resolved pixels of each source row, shared by the scaled rows */
+} SPRITE;
+/** @} end of Sprite */
+
+/** @name Sprite Overlay */
+/**@{
+ *
+ * Sprite drawn over the video buffer, keeping the pixels it covers
+ */
+typedef struct {
+	const SPRITE *sprite;	/**< @brief sprite to draw */
+	vg_surface_t *under;	/**< @brief pixels covered by the sprite, created on the first show */
+	int x;					/**< @brief x of the sprite while visible */
+	int y;					/**< @brief y of the sprite while visible */
+	int visible;			/**< @brief the sprite is in the video buffer */
+} SPRITE_OVERLAY;
+/** @} end of Sprite Overlay */
+
+/**
+ * @brief Compile a character-art sprite.
+ *
+ * Spaces are transparent, the digit n is drawn with palette[n]. Every art pixel
+ * becomes a scale x scale block on screen, rounded down to whole buffer pixels.
+ *
+ * @param art sprite rows, pitch chars apart
+ * @param width sprite width, in chars
+ * @param height sprite height, in rows
+ * @param pitch distance between two rows of art, in chars
+ * @param scale size of each art pixel on screen
+ * @param palette colors indexed by the art digits
+ * @param palette_size number of colors in palette
+ *
+ * @return the compiled sprite, NULL on error
+ */
+SPRITE *sprite_compile(const char *art, unsigned int width, unsigned int height, unsigned int pitch,
+		unsigned int scale, const unsigned int palette[], unsigned int palette_size);
+/**
+ * @brief Free a compiled sprite.
+ *
+ * @param sprite sprite to free, may be NULL
+ */
+void sprite_destroy(SPRITE *sprite);
+/**
+ * @brief Draw a compiled sprite in the video buffer, clipped to the screen.
+ *
+ * @param sprite sprite to draw
+ * @param x sprite's x coordinate (left)
+ * @param y sprite's y coordinate (top)
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int sprite_draw(const SPRITE *sprite, int x, int y);
+
+/**
+ * @brief Draw an overlay sprite, saving the pixels it covers.
+ *
+ * If the overlay is already visible it is first hidden, so only its old and
+ * new rectangles are damaged.
+ *
+ * @param overlay overlay to show
+ * @param x sprite's x coordinate (left)
+ * @param y sprite's y coordinate (top)
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int sprite_overlay_show(SPRITE_OVERLAY *overlay, int x, int y);
+/**
+ * @brief Restore the pixels covered by a visible overlay.
+ *
+ * @param overlay overlay to hide
+ */
+void sprite_overlay_hide(SPRITE_OVERLAY *overlay);
+/**
+ * @brief Forget the saved pixels of an overlay, for when the video buffer was redrawn under it.
+ *
+ * @param overlay overlay to drop
+ */
+void sprite_overlay_drop(SPRITE_OVERLAY *overlay);
+
+/** @} end of sprite */
+
+#endif /* SPRITE_H_ */
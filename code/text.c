@@ -0,0 +1,219 @@
+/*
+ * text.c
+ *
+ * Text layout for the segment font.
+ */
+
+#include "text.h"
+#include "video_gr.h"
+#include "font.h"
+#include "dlist.h"
+
+/** @name Text Cache Entry */
+/**@{
+ *
+ * Cached layout and the request it answers
+ */
+typedef struct {
+	char *str;				/**< @brief copy of the laid out chars, NULL if the entry is free */
+	unsigned int length;	/**< @brief number of chars in str */
+	unsigned int size;		/**< @brief char size */
+	unsigned int color;		/**< @brief char color */
+	unsigned int wrap;		/**< @brief maximum line width */
+	unsigned long last_use;	/**< @brief value of use_clock on the last hit */
+	TEXT_LAYOUT *layout;	/**< @brief the layout */
+} TEXT_ENTRY;
+/** @} end of Text Cache Entry */
+
+static TEXT_ENTRY cache[TEXT_CACHE_ENTRIES];	/**< @brief Layout cache */
+static unsigned long use_clock = 0;				/**< @brief Incremented on every lookup, for LRU eviction */
+
+/**
+ * @brief Get the number of chars of a string up to its end.
+ */
+static unsigned int text_length(const char *str) {
+	unsigned int length = 0;
+
+	while((str[length] != TEXT_END) && (str[length] != '\0')) {
+		length++;
+	}
+
+	return length;
+}
+
+TEXT_LAYOUT *text_layout(const char *str, unsigned int size, unsigned int color, unsigned int wrap) {
+	unsigned int length = text_length(str);
+	unsigned int i, k, line_start = 0, char_width, char_height;
+	int x = 0, y = 0, advance, shift, space = -1;
+	TEXT_LAYOUT *layout;
+	TEXT_GLYPH *glyph;
+	font_glyph_t found;
+
+	if((layout = malloc(sizeof(TEXT_LAYOUT))) == NULL) {
+		return NULL;
+	}
+	if((layout->glyphs = malloc(sizeof(TEXT_GLYPH) * (length + 1))) == NULL) {
+		free(layout);
+		return NULL;
+	}
+
+	layout->size = size;
+	layout->color = color;
+	layout->count = 0;
+	layout->width = 0;
+	layout->lines = 1;
+
+	for(i = 0; i < length; i++) {
+		if(str[i] == TEXT_NEWLINE) {
+			x = 0;
+			y += TEXT_LINE_SPACING * size;
+			line_start = layout->count;
+			space = -1;
+			layout->lines++;
+			continue;
+		}
+
+		if((advance = font_lookup_char(color, str[i], size, &found)) == -1) {
+			text_destroy(layout);
+			return NULL;
+		}
+
+		/* a word whose pixels cross the limit moves to a new line, with the rest of the word */
+		if(wrap && (str[i] != ' ') && (x > 0) && (x + found.extent > (int)wrap) && (space >= (int)line_start)) {
+			shift = ((unsigned int)space + 1 < layout->count) ? layout->glyphs[space + 1].x : x;
+			y += TEXT_LINE_SPACING * size;
+			for(k = space + 1; k < layout->count; k++) {
+				layout->glyphs[k].x -= shift;
+				layout->glyphs[k].y = y;
+			}
+			x -= shift;
+			line_start = space + 1;
+			space = -1;
+			layout->lines++;
+		}
+
+		glyph = &layout->glyphs[layout->count];
+		glyph->x = x;
+		glyph->y = y;
+		glyph->symbol = str[i];
+		glyph->glyph = found;
+		if(str[i] == ' ') {
+			space = layout->count;
+		}
+		layout->count++;
+
+		x += advance + TEXT_SPACING * size;
+	}
+
+	layout->advance = x;
+
+	/* the widest line, up to the last pixel of its last visible glyph */
+	for(k = 0; k < layout->count; k++) {
+		glyph = &layout->glyphs[k];
+		if(glyph->symbol == ' ') {
+			continue;
+		}
+		if(glyph->x + glyph->glyph.extent > (int)layout->width) {
+			layout->width = glyph->x + glyph->glyph.extent;
+		}
+	}
+
+	vg_char_extent(size, &char_width, &char_height);
+	layout->height = (layout->lines - 1) * TEXT_LINE_SPACING * size + char_height;
+
+	return layout;
+}
+
+void text_destroy(TEXT_LAYOUT *layout) {
+	if(layout == NULL) {
+		return;
+	}
+	free(layout->glyphs);
+	free(layout);
+}
+
+static void entry_free(TEXT_ENTRY *entry) {
+	free(entry->str);
+	text_destroy(entry->layout);
+	entry->str = NULL;
+	entry->layout = NULL;
+}
+
+const TEXT_LAYOUT *text_get(const char *str, unsigned int size, unsigned int color, unsigned int wrap) {
+	unsigned int length = text_length(str);
+	TEXT_ENTRY *victim = &cache[0];
+	unsigned int i;
+
+	use_clock++;
+
+	for(i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+		if((cache[i].str != NULL) && (cache[i].length == length) && (cache[i].size == size) &&
+				(cache[i].color == color) && (cache[i].wrap == wrap) && (memcmp(cache[i].str, str, length) == 0)) {
+			cache[i].last_use = use_clock;
+			return cache[i].layout;
+		}
+		if(cache[i].str == NULL) {
+			victim = &cache[i];
+		}
+		else if((victim->str != NULL) && (cache[i].last_use < victim->last_use)) {
+			victim = &cache[i];
+		}
+	}
+
+	entry_free(victim);
+
+	if((victim->layout = text_layout(str, size, color, wrap)) == NULL) {
+		return NULL;
+	}
+	if((victim->str = malloc(length + 1)) == NULL) {
+		entry_free(victim);
+		return NULL;
+	}
+	memcpy(victim->str, str, length);
+	victim->str[length] = '\0';
+	victim->length = length;
+	victim->size = size;
+	victim->color = color;
+	victim->wrap = wrap;
+	victim->last_use = use_clock;
+
+	return victim->layout;
+}
+
+int text_measure(const char *str, unsigned int size, unsigned int color, unsigned int wrap, unsigned int *width, unsigned int *height) {
+	const TEXT_LAYOUT *layout = text_get(str, size, color, wrap);
+
+	if(layout == NULL) {
+		return -1;
+	}
+
+	if(width != NULL) {
+		*width = layout->width;
+	}
+	if(height != NULL) {
+		*height = layout->height;
+	}
+
+	return layout->advance;
+}
+
+int text_draw(const TEXT_LAYOUT *layout, int x, int y) {
+	const TEXT_GLYPH *glyph = layout->glyphs;
+	const TEXT_GLYPH *end = layout->glyphs + layout->count;
+
+	for(; glyph < end; glyph++) {
+		if(dl_glyph(x + glyph->x, y + glyph->y, layout->color, glyph->symbol, layout->size, &glyph->glyph) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void text_cache_flush() {
+	unsigned int i;
+
+	for(i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+		entry_free(&cache[i]);
+	}
+}
@@ -0,0 +1,115 @@
+#ifndef TEXT_H_
+#define TEXT_H_
+
+#include "libraries.h"
+#include "font.h"
+
+/** @defgroup text text
+ * @{
+ *
+ * Text layout: measuring, wrapping and cached glyph positions for the segment font.
+ */
+
+#define TEXT_END			'.'	/**< @brief Char ending a string; it is not drawn */
+#define TEXT_NEWLINE		':'	/**< @brief Char starting a new line; it is not drawn */
+#define TEXT_SPACING		2	/**< @brief Space after each glyph, in multiples of the char size */
+#define TEXT_LINE_SPACING	6	/**< @brief Distance between lines, in multiples of the char size */
+#define TEXT_CACHE_ENTRIES	32	/**< @brief Layouts kept by text_get(); the least recently used one is dropped */
+
+/** @name Text Glyph */
+/**@{
+ *
+ * Char placed by a layout
+ */
+typedef struct {
+	int x;				/**< @brief x offset from the layout's origin */
+	int y;				/**< @brief y offset from the layout's origin */
+	char symbol;		/**< @brief char to draw */
+	font_glyph_t glyph;	/**< @brief glyph cache entry and pixel extent of the char */
+} TEXT_GLYPH;
+/** @} end of Text Glyph */
+
+/** @name Text Layout */
+/**@{
+ *
+ * Laid out string, ready to be drawn anywhere
+ */
+typedef struct {
+	unsigned int size;		/**< @brief char size */
+	unsigned int color;		/**< @brief char color */
+	unsigned int count;		/**< @brief number of glyphs */
+	TEXT_GLYPH *glyphs;		/**< @brief glyphs, in string order */
+	unsigned int width;		/**< @brief width of the widest line, up to the last pixel of its last glyph */
+	unsigned int height;	/**< @brief height from the top of the first line to the bottom of the last */
+	unsigned int lines;		/**< @brief number of lines */
+	int advance;			/**< @brief x of the pen after the last glyph, as drawString() returns */
+} TEXT_LAYOUT;
+/** @} end of Text Layout */
+
+/**
+ * @brief Lay a string out.
+ *
+ * Glyphs are TEXT_SPACING * size apart and lines TEXT_LINE_SPACING * size apart.
+ * The string ends at TEXT_END or at '\0', and TEXT_NEWLINE starts a new line.
+ *
+ * @param str string to lay out
+ * @param size char size
+ * @param color char color
+ * @param wrap maximum line width, up to the last pixel of a line; longer lines are broken at their last space. 0 for no limit
+ *
+ * @return the layout, NULL on error (e.g. a char the font does not have)
+ */
+TEXT_LAYOUT *text_layout(const char *str, unsigned int size, unsigned int color, unsigned int wrap);
+/**
+ * @brief Free a layout created with text_layout().
+ *
+ * @param layout layout to free, may be NULL
+ */
+void text_destroy(TEXT_LAYOUT *layout);
+/**
+ * @brief Get the layout of a string from the layout cache, laying it out on a miss.
+ *
+ * Layouts are found by the string's contents, not by its address.
+ *
+ * @param str string to lay out
+ * @param size char size
+ * @param color char color
+ * @param wrap maximum line width, 0 for no limit
+ *
+ * @return the layout, valid until TEXT_CACHE_ENTRIES other layouts are requested; NULL on error
+ */
+const TEXT_LAYOUT *text_get(const char *str, unsigned int size, unsigned int color, unsigned int wrap);
+/**
+ * @brief Measure a string without drawing it.
+ *
+ * The layout is taken from the cache, so measuring a string that is then
+ * drawn in the same color lays it out only once.
+ *
+ * @param str string to measure
+ * @param size char size
+ * @param color char color
+ * @param wrap maximum line width, 0 for no limit
+ * @param width width of the widest line, may be NULL
+ * @param height height of all lines, may be NULL
+ *
+ * @return pen advance after the last glyph, as drawString() returns; -1 on error
+ */
+int text_measure(const char *str, unsigned int size, unsigned int color, unsigned int wrap, unsigned int *width, unsigned int *height);
+/**
+ * @brief Draw a layout, through the display list, with the glyphs found when it was laid out.
+ *
+ * @param layout layout to draw
+ * @param x layout's x coordinate (left)
+ * @param y layout's y coordinate (top)
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int text_draw(const TEXT_LAYOUT *layout, int x, int y);
+/**
+ * @brief Drop every cached layout.
+ */
+void text_cache_flush();
+
+/** @} end of text */
+
+#endif /* TEXT_H_ */
@@ -8,6 +8,8 @@
 #include "timer.h"
 #include "i8254.h"
 
+static int timer_hook_id;	/**< @brief Hook id the kernel returned, which sys_irqrmpolicy() takes */
+
 int timer_set_square(unsigned long timer, unsigned long freq) {
 
 	unsigned char selectedTimer, controlRegister, lsb, msb;
@@ -42,9 +44,9 @@ int timer_set_square(unsigned long timer, unsigned long freq) {
 
 int timer_subscribe_int(const unsigned int timer0_id) {
 
-	unsigned int hook_id = timer0_id;
+	timer_hook_id = timer0_id;
 
-	if (sys_irqsetpolicy(TIMER_IRQ, IRQ_REENABLE, &hook_id) != OK){
+	if (sys_irqsetpolicy(TIMER_IRQ, IRQ_REENABLE, &timer_hook_id) != OK){
 		//printf("timer sys_irqsetpolicy() failed!\n");
 		return -1;
 	}
@@ -55,9 +57,7 @@ int timer_subscribe_int(const unsigned int timer0_id) {
 
 int timer_unsubscribe_int(const unsigned int timer0_id) {
 
-	unsigned int hook_id = timer0_id;
-
-	if(!sys_irqrmpolicy(&hook_id)) {
+	if(sys_irqrmpolicy(&timer_hook_id) != OK) {
 		//printf("timer sys_irqrmpolicy() failed!\n");
 		return -1;
 	}
@@ -11,17 +11,35 @@
 #define LINEAR_MODEL_BIT 14
 
 #define MODE_INFO_BLOCK_SIZE 256
+#define PALETTE_ENTRY_SIZE 4
+#define PALETTE_ENTRIES 256
+
+#define VBE_OK 0x004F
 
 #define PB2BASE(x) (((x) >> 4) & 0x0F000)
 #define PB2OFF(x) ((x) & 0x0FFFF)
 
+static unsigned int lm_ready = 0;		/**< @brief Whether low memory was initialized */
+static mmap_t palette_block;			/**< @brief Low memory table for the palette calls, kept while the program runs */
+static unsigned int palette_ready = 0;	/**< @brief Whether palette_block is allocated */
+
+/**
+ * @brief Initializes the low memory area, the first time it is needed
+ */
+static void vbe_lm_init() {
+	if(!lm_ready) {
+		lm_init();
+		lm_ready = 1;
+	}
+}
+
 int vbe_get_mode_info(unsigned short mode, vbe_mode_info_t *vmi_p) {
 
 	mmap_t map_address;
 	struct reg86u reg86;
 
 	/* Initialized low memory area */
-	lm_init();
+	vbe_lm_init();
 
 	/* Allocates a memory block in low memory area */
 	if(lm_alloc(sizeof(vbe_mode_info_t), &map_address) == NULL) {
@@ -42,3 +60,79 @@ int vbe_get_mode_info(unsigned short mode, vbe_mode_info_t *vmi_p) {
   return 0;
 }
 
+int vbe_set_dac_width(unsigned int bits) {
+
+	struct reg86u reg86;
+
+	reg86.u.w.ax = 0x4F08; // VBE DAC palette format
+	reg86.u.b.bl = 0x00;
+	reg86.u.b.bh = bits;
+	reg86.u.b.intno = 0x10;
+
+	if((sys_int86(&reg86) != OK) || (reg86.u.w.ax != VBE_OK) || (reg86.u.b.bh != bits)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+int vbe_palette_init() {
+
+	if(palette_ready) {
+		return 0;
+	}
+
+	vbe_lm_init();
+
+	if(lm_alloc(PALETTE_ENTRIES * PALETTE_ENTRY_SIZE, &palette_block) == NULL) {
+		return -1;
+	}
+
+	palette_ready = 1;
+
+	return 0;
+}
+
+/**
+ * @brief Call VBE function 0x09 with the palette table in low memory.
+ *
+ * @param operation 0x00 to set the palette, 0x01 to get it
+ */
+static int vbe_palette(unsigned char operation, unsigned int first, unsigned int count, unsigned char *entries) {
+
+	struct reg86u reg86;
+
+	if((first + count > PALETTE_ENTRIES) || (vbe_palette_init() != 0)) {
+		return -1;
+	}
+
+	if(operation == 0x00) {
+		memcpy(palette_block.virtual, entries, count * PALETTE_ENTRY_SIZE);
+	}
+
+	reg86.u.w.ax = 0x4F09; // VBE palette data
+	reg86.u.b.bl = operation;
+	reg86.u.w.cx = count;
+	reg86.u.w.dx = first;
+	reg86.u.w.es = PB2BASE(palette_block.phys);
+	reg86.u.w.di = PB2OFF(palette_block.phys);
+	reg86.u.b.intno = 0x10;
+
+	if((sys_int86(&reg86) != OK) || (reg86.u.w.ax != VBE_OK)) {
+		return -1;
+	}
+
+	if(operation == 0x01) {
+		memcpy(entries, palette_block.virtual, count * PALETTE_ENTRY_SIZE);
+	}
+
+	return 0;
+}
+
+int vbe_set_palette(unsigned int first, unsigned int count, const unsigned char *entries) {
+	return vbe_palette(0x00, first, count, (unsigned char *)entries);
+}
+
+int vbe_get_palette(unsigned int first, unsigned int count, unsigned char *entries) {
+	return vbe_palette(0x01, first, count, entries);
+}
@@ -90,6 +90,43 @@ typedef struct {
  */
 int vbe_get_mode_info(unsigned short mode, vbe_mode_info_t *vmi_p);
 
+/**
+ * @brief Sets the width of the DAC's color channels, by calling VBE function 0x08
+ *
+ * @param bits bits per channel, 6 is the VGA standard
+ * @return 0 on success, non-zero otherwise (e.g. a fixed width DAC)
+ */
+int vbe_set_dac_width(unsigned int bits);
+
+/**
+ * @brief Allocates the low memory table used by the VBE palette calls
+ *
+ * Done once: the table is kept and reused by every later palette call.
+ *
+ * @return 0 on success, non-zero otherwise
+ */
+int vbe_palette_init();
+
+/**
+ * @brief Loads entries of the palette into the DAC, by calling VBE function 0x09
+ *
+ * @param first index of the first entry to load
+ * @param count number of entries to load
+ * @param entries count entries of 4 bytes: blue, green, red and an unused byte
+ * @return 0 on success, non-zero otherwise (e.g. a VBE older than 2.0)
+ */
+int vbe_set_palette(unsigned int first, unsigned int count, const unsigned char *entries);
+
+/**
+ * @brief Reads entries of the palette from the DAC, by calling VBE function 0x09
+ *
+ * @param first index of the first entry to read
+ * @param count number of entries to read
+ * @param entries where to store count entries of 4 bytes: blue, green, red and an unused byte
+ * @return 0 on success, non-zero otherwise
+ */
+int vbe_get_palette(unsigned int first, unsigned int count, unsigned char *entries);
+
  /** @} end of vbe */
 
 #endif /* __VBE_H */
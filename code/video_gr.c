@@ -8,19 +8,86 @@
 #include "video_gr.h"
 #include "vbe.h"
 #include "game.h"
+#include "memops.h"
+#include "pixfmt.h"
+#include "palette.h"
+#include "fb.h"
 
 /* Private global variables */
 
-static unsigned char *video_mem;		/**< @brief Process address to which VRAM is mapped */
 static unsigned char *buffer;			/**< @brief pointer to the video buffer's adress */
 static unsigned int buffer_size;		/**< @brief buffer size */
+static unsigned char *buffer_block = NULL;	/**< @brief Allocation holding the aligned video buffer */
 
 static unsigned h_res;			/**< @brief Horizontal screen resolution in pixels */
 static unsigned v_res;			/**< @brief Vertical screen resolution in pixels */
 static unsigned bits_per_pixel; /**< @brief Number of VRAM bits per pixel */
+static unsigned bytes_per_pixel = 1; /**< @brief Number of VRAM bytes per pixel */
+static unsigned pitch;			/**< @brief Bytes from the start of a row of buffer to the start of the next */
+static unsigned int scale = 1;			/**< @brief Screen pixels per video buffer pixel, in each direction */
+static unsigned int requested_scale = 1;	/**< @brief Scale applied by the next vg_init() */
+static unsigned char *scaled_row = NULL;	/**< @brief A VRAM row expanded from the video buffer, when scale is above 1 */
+static unsigned int overdraw = 0;		/**< @brief The video buffer counts writes instead of holding colors */
+static uint32_t heat[256];				/**< @brief VRAM pixel shown for each write count */
+static vg_overdraw_stats_t overdraw_stats;	/**< @brief Write counts of the last frame */
+static const pixfmt_t *format = &pixfmt_8;	/**< @brief Writers for the mode's pixel format */
+
+static vg_surface_t vram;				/**< @brief VRAM, as mapped to the process */
+static vg_surface_t screen;				/**< @brief The video buffer, as a surface */
+static vg_surface_t *target = &screen;	/**< @brief Surface being drawn to; buffer, h_res, v_res and pitch are its own */
+static vg_rect_t clip;					/**< @brief Part of the target drawn to, always inside it */
+
+static vg_rect_t damage[VG_DAMAGE_MAX_RECTS];	/**< @brief Regions of the buffer changed since the last present */
+static unsigned int damage_count = 0;		/**< @brief Number of valid rectangles in damage[] */
+static unsigned int damage_full = 0;		/**< @brief Whole buffer changed since the last present */
+static unsigned int damage_suspended = 0;	/**< @brief Nesting level of primitives which already marked their own damage */
+static vg_present_stats_t present_stats;	/**< @brief Statistics of the last present */
+static unsigned int present_mode = VG_PRESENT_DAMAGE;	/**< @brief How presents find what to copy */
+static unsigned char *shadow = NULL;		/**< @brief Copy of VRAM's contents laid out as the video buffer (VG_PRESENT_DIFF) */
+static unsigned char *shadow_block = NULL;	/**< @brief Allocation holding the aligned shadow */
+static unsigned int shadow_valid = 0;		/**< @brief The shadow holds what VRAM shows */
+static unsigned int calibrated = 0;		/**< @brief The copy variant was picked by an earlier vg_init() */
+
+static int *span_left = NULL;			/**< @brief Leftmost pixel of each polygon row */
+static int *span_right = NULL;			/**< @brief Rightmost pixel of each polygon row */
+static unsigned int span_rows = 0;		/**< @brief Capacity of span_left and span_right */
+static vg_point_t *scaled_points = NULL;	/**< @brief Polygon vertices converted to the video buffer */
+static unsigned int scaled_count = 0;		/**< @brief Capacity of scaled_points */
 
 const int default_width = 2;
 
+#define PRESENT_CALIBRATION_REPS	4	/**< @brief Timed copies per copy variant on the first vg_init() */
+#define PRESENT_CALIBRATION_BYTES	(64 * 1024)	/**< @brief Bytes of VRAM each copy variant is timed on */
+
+/** @brief Indexed color of each write count, black for none up to white for HEAT_LEVELS or more */
+static const unsigned char heat_colors[] = { 0, 1, 2, 14, 42, 40, 36, 15 };
+#define HEAT_LEVELS	(sizeof(heat_colors) / sizeof(heat_colors[0]) - 1)	/**< @brief Write count shown in the last heat color */
+
+#define PIXEL(x, y)	(buffer + (y)*pitch + (x)*bytes_per_pixel)	/**< @brief Address of a pixel of the target */
+
+static int draw_line(int xi, int yi, int xf, int yf, unsigned int color);
+
+/**
+ * @brief Convert a screen coordinate to the video buffer, rounding down.
+ */
+static int to_buffer(int v) {
+	return (v >= 0) ? v / (int)scale : -((-v + (int)scale - 1) / (int)scale);
+}
+
+/**
+ * @brief Convert a screen coordinate to the video buffer, rounding up.
+ */
+static int to_buffer_up(int v) {
+	return -to_buffer(-v);
+}
+
+/**
+ * @brief Convert a glyph size to the video buffer; glyphs never vanish.
+ */
+static unsigned int glyph_size(unsigned int size) {
+	return ((scale == 1) || (size >= scale)) ? size / scale : 1;
+}
+
 /** @name Chars */
 /**@{
  *
@@ -72,6 +139,22 @@ typedef struct
 } VBE_INFO;
 /**@} end of Vbe Info Struct */
 
+/**
+ * @brief (Re)allocate the shadow of VRAM for the current video buffer size.
+ */
+static int shadow_alloc() {
+	free(shadow_block);
+	shadow = NULL;
+	shadow_valid = 0;
+
+	if((shadow_block = malloc(buffer_size + VG_BUFFER_ALIGN - 1)) == NULL) {
+		return -1;
+	}
+	shadow = (unsigned char *)(((unsigned long)shadow_block + VG_BUFFER_ALIGN - 1) & ~(unsigned long)(VG_BUFFER_ALIGN - 1));
+
+	return 0;
+}
+
 int vg_init(unsigned short mode) {
 
 	struct reg86u reg86;
@@ -79,17 +162,37 @@ int vg_init(unsigned short mode) {
 
 	VBE_INFO vb_info;
 	vbe_mode_info_t vmi_p;
+	pixfmt_layout_t layout;
+	const pixfmt_t *mode_format;
+	const pixfmt_t *buffer_format;
+	unsigned int i;
 
 	/* Get mode information from vbe */
 	if(vbe_get_mode_info(mode, &vmi_p) != 0) {
 		return -1;
 	}
 
+	if((mode_format = pixfmt_get(vmi_p.BitsPerPixel)) == NULL) {
+		return -1;
+	}
+
+	/* the video buffer is scale times smaller than the screen in each direction */
+	if((vmi_p.XResolution % requested_scale) || (vmi_p.YResolution % requested_scale)) {
+		return -1;
+	}
+	scale = requested_scale;
+	buffer_format = overdraw ? &pixfmt_heat : mode_format;
+
 	vb_info.vram_base = vmi_p.PhysBasePtr;
 	vb_info.h_res = vmi_p.XResolution;
 	vb_info.v_res = vmi_p.YResolution;
 	vb_info.bits_per_pixel = vmi_p.BitsPerPixel;
-	vb_info.vram_size = vb_info.h_res * vb_info.v_res * vb_info.bits_per_pixel;
+	/* rows may be padded on the adapter */
+	vram.pitch = vmi_p.BytesPerScanLine;
+	if(vram.pitch < vb_info.h_res * mode_format->bytes_per_pixel) {
+		vram.pitch = vb_info.h_res * mode_format->bytes_per_pixel;
+	}
+	vb_info.vram_size = vram.pitch * vb_info.v_res;
 
 	//range.mr_base = vmi_p.PhysBasePtr;
 	range.mr_base = (phys_bytes)(vb_info.vram_base);
@@ -99,15 +202,31 @@ int vg_init(unsigned short mode) {
 		return -1;
 	}
 
-	video_mem = vm_map_phys(SELF, (void *)range.mr_base, vb_info.vram_size);
+	vram.pixels = vm_map_phys(SELF, (void *)range.mr_base, vb_info.vram_size);
+	vram.width = vb_info.h_res;
+	vram.height = vb_info.v_res;
+	vram.format = mode_format;
 
-	buffer = malloc(vb_info.h_res * vb_info.v_res * (vb_info.bits_per_pixel / 8));
+	/* aligned rows start on a cache line, so row fills and copies never split one */
+	screen.pitch = (vb_info.h_res / scale * buffer_format->bytes_per_pixel + VG_BUFFER_ALIGN - 1) & ~(VG_BUFFER_ALIGN - 1);
+	buffer_size = screen.pitch * (vb_info.v_res / scale);
+	free(buffer_block);
+	buffer_block = malloc(buffer_size + VG_BUFFER_ALIGN - 1);
 
-	if(buffer == NULL) {
+	if(buffer_block == NULL) {
 		return -1;
 	}
+	buffer = (unsigned char *)(((unsigned long)buffer_block + VG_BUFFER_ALIGN - 1) & ~(unsigned long)(VG_BUFFER_ALIGN - 1));
 
-	buffer_size = vb_info.h_res * vb_info.v_res * (vb_info.bits_per_pixel / 8);
+	if((present_mode == VG_PRESENT_DIFF) && (shadow_alloc() != 0)) {
+		return -1;
+	}
+
+	free(scaled_row);
+	scaled_row = NULL;
+	if((scale > 1) && ((scaled_row = malloc(vram.pitch)) == NULL)) {
+		return -1;
+	}
 
 	reg86.u.b.ah = 0x4f;
 	reg86.u.b.al = 0x02;
@@ -118,9 +237,54 @@ int vg_init(unsigned short mode) {
 		return -1;
 	}
 
-	h_res = vb_info.h_res;
-	v_res = vb_info.v_res;
+	h_res = vb_info.h_res / scale;
+	v_res = vb_info.v_res / scale;
 	bits_per_pixel = vb_info.bits_per_pixel;
+	format = buffer_format;
+	bytes_per_pixel = format->bytes_per_pixel;
+
+	/* Direct color modes show the indexed colors as the default VGA palette does */
+	if(bits_per_pixel == 8) {
+		pixfmt_set_layout(NULL);
+	}
+	else {
+		layout.red_size = vmi_p.RedMaskSize;
+		layout.red_position = vmi_p.RedFieldPosition;
+		layout.green_size = vmi_p.GreenMaskSize;
+		layout.green_position = vmi_p.GreenFieldPosition;
+		layout.blue_size = vmi_p.BlueMaskSize;
+		layout.blue_position = vmi_p.BlueFieldPosition;
+		pixfmt_set_layout(&layout);
+	}
+
+	/* the DAC keeps whatever it had before the mode was set */
+	if(palette_init(bits_per_pixel == 8) != 0) {
+		return -1;
+	}
+
+	for(i = 0; i < 256; i++) {
+		heat[i] = pixfmt_map(heat_colors[(i < HEAT_LEVELS) ? i : HEAT_LEVELS]);
+	}
+
+	screen.pixels = buffer;
+	screen.width = h_res;
+	screen.height = v_res;
+	screen.format = format;
+	vg_set_target(NULL);
+
+	/* Pick the fastest way of writing to this adapter's memory, once: a slice tells as much as a frame */
+	memset(buffer, 0, buffer_size);
+	if(!calibrated) {
+		mem_copy_calibrate(vram.pixels, buffer, (buffer_size < PRESENT_CALIBRATION_BYTES) ? buffer_size : PRESENT_CALIBRATION_BYTES,
+				PRESENT_CALIBRATION_REPS);
+		calibrated = 1;
+	}
+
+	/* VRAM contents are unknown, the first present must be whole */
+	damage_count = 0;
+	damage_full = 1;
+	shadow_valid = 0;
+	memset(&present_stats, 0, sizeof(present_stats));
 
 	return 0;
 }
@@ -140,60 +304,516 @@ int vg_exit() {
   return 0;
 }
 
+unsigned int vg_get_bytes_per_pixel() {
+	return bytes_per_pixel;
+}
+
+uint32_t vg_map_color(unsigned int color) {
+	return pixfmt_map(color);
+}
+
+vg_surface_t *vg_surface_create(unsigned int width, unsigned int height) {
+	vg_surface_t *surface = malloc(sizeof(vg_surface_t));
+
+	if(surface == NULL) {
+		return NULL;
+	}
+
+	width = (width + scale - 1) / scale;
+	height = (height + scale - 1) / scale;
+
+	surface->pixels = calloc(width * height, bytes_per_pixel);
+	if(surface->pixels == NULL) {
+		free(surface);
+		return NULL;
+	}
+	surface->width = width;
+	surface->height = height;
+	surface->pitch = width * bytes_per_pixel;
+	surface->format = format;
+
+	return surface;
+}
+
+void vg_surface_destroy(vg_surface_t *surface) {
+	if(surface == NULL) {
+		return;
+	}
+	if(target == surface) {
+		vg_set_target(NULL);
+	}
+	free(surface->pixels);
+	free(surface);
+}
+
+void vg_set_target(vg_surface_t *surface) {
+	target = (surface != NULL) ? surface : &screen;
+	buffer = target->pixels;
+	h_res = target->width;
+	v_res = target->height;
+	pitch = target->pitch;
+	vg_set_clip(NULL);
+}
+
+vg_surface_t *vg_get_target() {
+	return (target != &screen) ? target : NULL;
+}
+
+void vg_set_clip(const vg_rect_t *rect) {
+	clip.x1 = 0;
+	clip.y1 = 0;
+	clip.x2 = h_res;
+	clip.y2 = v_res;
+
+	if(rect != NULL) {
+		/* every buffer pixel the rectangle touches */
+		clip.x1 = (to_buffer(rect->x1) > clip.x1) ? to_buffer(rect->x1) : clip.x1;
+		clip.y1 = (to_buffer(rect->y1) > clip.y1) ? to_buffer(rect->y1) : clip.y1;
+		clip.x2 = (to_buffer_up(rect->x2) < clip.x2) ? to_buffer_up(rect->x2) : clip.x2;
+		clip.y2 = (to_buffer_up(rect->y2) < clip.y2) ? to_buffer_up(rect->y2) : clip.y2;
+		if((clip.x1 >= clip.x2) || (clip.y1 >= clip.y2)) {
+			clip.x2 = clip.x1;
+			clip.y2 = clip.y1;
+		}
+	}
+}
+
+void vg_get_clip(vg_rect_t *rect) {
+	rect->x1 = clip.x1 * scale;
+	rect->y1 = clip.y1 * scale;
+	rect->x2 = clip.x2 * scale;
+	rect->y2 = clip.y2 * scale;
+}
+
+int vg_set_render_scale(unsigned int factor) {
+	if((factor == 0) || (factor > VG_MAX_RENDER_SCALE)) {
+		return -1;
+	}
+	requested_scale = factor;
+	return 0;
+}
+
+unsigned int vg_get_render_scale() {
+	return scale;
+}
+
+void vg_set_overdraw(unsigned int enable) {
+	overdraw = enable;
+}
+
+unsigned int vg_get_overdraw() {
+	return overdraw;
+}
+
+const vg_overdraw_stats_t *vg_get_overdraw_stats() {
+	return &overdraw_stats;
+}
+
 void swap(unsigned int *a, unsigned int *b) {
 	unsigned int c = *a;
 	*a = *b;
 	*b = c;
 }
 
-int vg_fill(unsigned int color) {
+static long rect_area(const vg_rect_t *r) {
+	return (long)(r->x2 - r->x1) * (long)(r->y2 - r->y1);
+}
 
-	unsigned long i = 0;
-	unsigned long size = (h_res * v_res);
+static void rect_union(vg_rect_t *dst, const vg_rect_t *a, const vg_rect_t *b) {
+	dst->x1 = (a->x1 < b->x1) ? a->x1 : b->x1;
+	dst->y1 = (a->y1 < b->y1) ? a->y1 : b->y1;
+	dst->x2 = (a->x2 > b->x2) ? a->x2 : b->x2;
+	dst->y2 = (a->y2 > b->y2) ? a->y2 : b->y2;
+}
+
+static int rect_contains(const vg_rect_t *outer, const vg_rect_t *inner) {
+	return (inner->x1 >= outer->x1) && (inner->x2 <= outer->x2) &&
+			(inner->y1 >= outer->y1) && (inner->y2 <= outer->y2);
+}
 
-	for (i = 0; i < size; i++) {
-		*(buffer + i) = color;
+/**
+ * @brief Merge damage[index] with every rectangle it can absorb without growing the copied area.
+ */
+static void damage_merge(unsigned int index) {
+	unsigned int i;
+	vg_rect_t u;
+	int merged = 1;
+
+	while(merged) {
+		merged = 0;
+		for(i = 0; i < damage_count; i++) {
+			if(i == index) {
+				continue;
+			}
+			rect_union(&u, &damage[index], &damage[i]);
+			if(rect_area(&u) <= rect_area(&damage[index]) + rect_area(&damage[i])) {
+				damage[index] = u;
+				damage[i] = damage[--damage_count];
+				if(index == damage_count) {
+					index = i;
+				}
+				merged = 1;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Merge the two rectangles whose union wastes the least area, freeing one slot.
+ */
+static void damage_collapse() {
+	unsigned int i, j, best_i = 0, best_j = 1;
+	long growth, best_growth = -1;
+	vg_rect_t u;
+
+	for(i = 0; i < damage_count; i++) {
+		for(j = i + 1; j < damage_count; j++) {
+			rect_union(&u, &damage[i], &damage[j]);
+			growth = rect_area(&u) - rect_area(&damage[i]) - rect_area(&damage[j]);
+			if((best_growth < 0) || (growth < best_growth)) {
+				best_growth = growth;
+				best_i = i;
+				best_j = j;
+			}
+		}
 	}
 
-	return 0;
+	rect_union(&damage[best_i], &damage[best_i], &damage[best_j]);
+	damage[best_j] = damage[--damage_count];
+	damage_merge(best_i);
+}
+
+/**
+ * @brief Mark a region of the video buffer as changed, in buffer coordinates.
+ */
+static void damage_add(int x1, int y1, int x2, int y2) {
+	unsigned int i;
+	long area = 0;
+	vg_rect_t r;
+
+	if(damage_full || damage_suspended || (target != &screen)) {
+		return;
+	}
+
+	/* nothing is drawn outside the clip rectangle */
+	r.x1 = (x1 < clip.x1) ? clip.x1 : x1;
+	r.y1 = (y1 < clip.y1) ? clip.y1 : y1;
+	r.x2 = (x2 > clip.x2) ? clip.x2 : x2;
+	r.y2 = (y2 > clip.y2) ? clip.y2 : y2;
+
+	if((r.x1 >= r.x2) || (r.y1 >= r.y2)) {
+		return;
+	}
+
+	for(i = 0; i < damage_count; i++) {
+		if(rect_contains(&damage[i], &r)) {
+			return;
+		}
+	}
+
+	if(damage_count == VG_DAMAGE_MAX_RECTS) {
+		damage_collapse();
+	}
+	damage[damage_count++] = r;
+	damage_merge(damage_count - 1);
+
+	for(i = 0; i < damage_count; i++) {
+		area += rect_area(&damage[i]);
+	}
+	if(100 * area > (long)VG_DAMAGE_FULL_PERCENT * screen.width * screen.height) {
+		vg_mark_damage_all();
+	}
+}
+
+void vg_mark_damage(int x1, int y1, int x2, int y2) {
+	damage_add(to_buffer(x1), to_buffer(y1), to_buffer_up(x2), to_buffer_up(y2));
+}
+
+void vg_mark_damage_all() {
+	if(target != &screen) {
+		return;
+	}
+	damage_full = 1;
+	damage_count = 0;
+}
+
+const vg_present_stats_t *vg_get_present_stats() {
+	return &present_stats;
+}
+
+int vg_fill(unsigned int color) {
+	return vg_fill_rect(0, 0, h_res * scale, v_res * scale, color);
 }
 
 int vg_set_pixel(unsigned int x, unsigned int y, unsigned int color) {
 
-	if((x >= h_res) || (y >= v_res)) {
-		return -1;
+	x /= scale;
+	y /= scale;
+
+	if(((int)x < clip.x1) || ((int)x >= clip.x2) || ((int)y < clip.y1) || ((int)y >= clip.y2)) {
+		return 0;
 	}
 
-	*(buffer + x + y*h_res) = color;
+	format->put(PIXEL(x, y), pixfmt_map(color));
+
+	damage_add(x, y, x + 1, y + 1);
 
 	return 0;
 }
 
 unsigned long vg_get_pixel(unsigned int x, unsigned int y) {
-	if((x >= h_res) || (y >= v_res)) {
+	return vg_surface_get_pixel(NULL, x, y);
+}
+
+unsigned long vg_surface_get_pixel(const vg_surface_t *surface, unsigned int x, unsigned int y) {
+	if(surface == NULL) {
+		surface = &screen;
+	}
+
+	x /= scale;
+	y /= scale;
+	if((x >= surface->width) || (y >= surface->height)) {
 		return -1;
 	}
+
+	return surface->format->get(surface->pixels + y*surface->pitch + x*surface->format->bytes_per_pixel);
+}
+
+/**
+ * @brief Copy a section of the video buffer to VRAM.
+ *
+ * Full-width sections are a single block when both have the same pitch,
+ * anything else is copied row by row.
+ *
+ * @return visible bytes copied
+ */
+static unsigned long present_rect(int x1, int y1, int x2, int y2) {
+	unsigned long row_bytes = (x2 - x1) * bytes_per_pixel;
+	const unsigned char *src = screen.pixels + y1*screen.pitch + x1*bytes_per_pixel;
+	unsigned char *dst = vram.pixels + y1*vram.pitch + x1*bytes_per_pixel;
+	unsigned char *out;
+	const unsigned char *in;
+	unsigned int k;
+	int y;
+
+	if(scale > 1) {
+		/* each buffer row becomes scale VRAM rows of pixels repeated scale times */
+		dst = vram.pixels + y1*scale*vram.pitch + x1*scale*bytes_per_pixel;
+		for(y = y1; y < y2; y++, src += screen.pitch) {
+			for(in = src, out = scaled_row; in < src + row_bytes; in += bytes_per_pixel) {
+				for(k = 0; k < scale; k++, out += bytes_per_pixel) {
+					memcpy(out, in, bytes_per_pixel);
+				}
+			}
+			for(k = 0; k < scale; k++, dst += vram.pitch) {
+				mem_copy(dst, scaled_row, row_bytes * scale);
+			}
+		}
+		return row_bytes * scale * scale * (y2 - y1);
+	}
+
+	if((screen.pitch == vram.pitch) && (x1 == 0) && (x2 == (int)screen.width)) {
+		mem_copy(dst, src, (y2 - y1 - 1) * screen.pitch + row_bytes);
+	}
 	else {
-		return *(video_mem + x + y*h_res);
+		for(y = y1; y < y2; y++, src += screen.pitch, dst += vram.pitch) {
+			mem_copy(dst, src, row_bytes);
+		}
 	}
+
+	return row_bytes * (y2 - y1);
+}
+
+/**
+ * @brief Copy to VRAM a byte range of a row of the video buffer.
+ *
+ * @return bytes copied
+ */
+static unsigned long present_bytes(unsigned int y, unsigned long offset, unsigned long length) {
+	unsigned int x1, x2;
+
+	if(scale == 1) {
+		mem_copy(vram.pixels + y*vram.pitch + offset, screen.pixels + y*screen.pitch + offset, length);
+		return length;
+	}
+
+	/* whole pixels covering the range */
+	x1 = offset / bytes_per_pixel;
+	x2 = (offset + length + bytes_per_pixel - 1) / bytes_per_pixel;
+	if(x2 > screen.width) {
+		x2 = screen.width;
+	}
+	return present_rect(x1, y, x2, y + 1);
+}
+
+/**
+ * @brief Copy to VRAM the blocks of the video buffer that differ from the shadow, updating it.
+ *
+ * Consecutive differing blocks of a row are copied together.
+ *
+ * @return bytes copied
+ */
+static unsigned long present_diff() {
+	unsigned long row_bytes = screen.width * bytes_per_pixel;
+	unsigned long blocks = row_bytes / MEM_DIFF_BLOCK;
+	unsigned long tail = row_bytes % MEM_DIFF_BLOCK;
+	unsigned long pos, run, offset, bytes = 0;
+	const unsigned char *src;
+	unsigned char *old;
+	unsigned int y;
+
+	present_stats.rects = 0;
+
+	for(y = 0; y < screen.height; y++) {
+		src = screen.pixels + y*screen.pitch;
+		old = shadow + y*screen.pitch;
+
+		pos = 0;
+		while(pos < blocks) {
+			pos += mem_equal_blocks(src + pos*MEM_DIFF_BLOCK, old + pos*MEM_DIFF_BLOCK, blocks - pos);
+			if(pos == blocks) {
+				break;
+			}
+			run = mem_differ_blocks(src + pos*MEM_DIFF_BLOCK, old + pos*MEM_DIFF_BLOCK, blocks - pos);
+			offset = pos*MEM_DIFF_BLOCK;
+			bytes += present_bytes(y, offset, run*MEM_DIFF_BLOCK);
+			memcpy(old + offset, src + offset, run*MEM_DIFF_BLOCK);
+			present_stats.rects++;
+			present_stats.blocks_written += run;
+			pos += run;
+		}
+
+		/* rows not made of whole blocks end with a short one */
+		offset = blocks*MEM_DIFF_BLOCK;
+		if(tail && (memcmp(src + offset, old + offset, tail) != 0)) {
+			bytes += present_bytes(y, offset, tail);
+			memcpy(old + offset, src + offset, tail);
+			present_stats.rects++;
+			present_stats.blocks_written++;
+		}
+	}
+
+	present_stats.blocks_compared = screen.height * (blocks + (tail ? 1 : 0));
+
+	return bytes;
+}
+
+/**
+ * @brief Show the write counts of the video buffer as heat colors, then reset them.
+ *
+ * @return bytes copied
+ */
+static unsigned long present_overdraw() {
+	unsigned int vram_bytes = vram.format->bytes_per_pixel;
+	unsigned long row_bytes = screen.width * scale * vram_bytes;
+	unsigned char *row, *dst;
+	unsigned int x, y, k;
+
+	/* rows are built in system memory when they are written more than once; VRAM is never read */
+	dst = scaled_row;
+
+	memset(&overdraw_stats, 0, sizeof(overdraw_stats));
+	overdraw_stats.pixels = screen.width * screen.height;
+
+	for(y = 0; y < screen.height; y++) {
+		row = screen.pixels + y*screen.pitch;
+		if(scale == 1) {
+			dst = vram.pixels + y*vram.pitch;
+		}
+		for(x = 0; x < screen.width; x++) {
+			overdraw_stats.writes += row[x];
+			overdraw_stats.covered += (row[x] != 0);
+			if(row[x] > overdraw_stats.max) {
+				overdraw_stats.max = row[x];
+			}
+			vram.format->span(dst + x*scale*vram_bytes, heat[row[x]], scale);
+		}
+		for(k = 0; (scale > 1) && (k < scale); k++) {
+			mem_copy(vram.pixels + (y*scale + k)*vram.pitch, scaled_row, row_bytes);
+		}
+		/* each frame shows its own writes */
+		memset(row, 0, screen.width);
+	}
+
+	return row_bytes * scale * screen.height;
 }
 
 int vg_draw_buffer_to_mem() {
-	unsigned char *ptr_buff = buffer;
-	unsigned char *ptr_mem = video_mem;
-	unsigned int i = 0;
+	unsigned int i;
+	unsigned long bytes = 0;
+
+	present_stats.blocks_compared = 0;
+	present_stats.blocks_written = 0;
 
-	while(i < buffer_size) {
-		i++;
-		*ptr_mem = *ptr_buff;
-		ptr_buff++;
-		ptr_mem++;
+	fb_present_begin();
+
+	if(overdraw) {
+		bytes = present_overdraw();
+		present_stats.rects = 1;
+		damage_full = 1;
+	}
+	else if((present_mode == VG_PRESENT_DIFF) && shadow_valid) {
+		bytes = present_diff();
+		damage_full = 0;
 	}
+	else if(damage_full || (present_mode == VG_PRESENT_DIFF)) {
+		bytes = present_rect(0, 0, screen.width, screen.height);
+		present_stats.rects = 1;
+		damage_full = 1;
+		if(present_mode == VG_PRESENT_DIFF) {
+			memcpy(shadow, screen.pixels, buffer_size);
+			shadow_valid = 1;
+			present_stats.blocks_written = screen.height * ((screen.width * bytes_per_pixel + MEM_DIFF_BLOCK - 1) / MEM_DIFF_BLOCK);
+		}
+	}
+	else {
+		for(i = 0; i < damage_count; i++) {
+			bytes += present_rect(damage[i].x1, damage[i].y1, damage[i].x2, damage[i].y2);
+		}
+		present_stats.rects = damage_count;
+	}
+
+	fb_present_end();
+
+	present_stats.frames++;
+	present_stats.bytes_uploaded = bytes;
+	present_stats.bytes_total += bytes;
+	present_stats.full_frame = damage_full;
+
+	damage_count = 0;
+	damage_full = 0;
 
 	return 0;
 }
 
-int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned int color, unsigned long number, const unsigned int size) {
+int vg_set_present_mode(unsigned int mode) {
+	switch(mode) {
+	case VG_PRESENT_DAMAGE:
+		free(shadow_block);
+		shadow_block = NULL;
+		shadow = NULL;
+		shadow_valid = 0;
+		break;
+	case VG_PRESENT_DIFF:
+		/* before vg_init() the shadow is allocated along with the video buffer */
+		if((present_mode != VG_PRESENT_DIFF) && buffer_size && (shadow_alloc() != 0)) {
+			return -1;
+		}
+		break;
+	default:
+		return -1;
+	}
+
+	present_mode = mode;
+	return 0;
+}
+
+unsigned int vg_get_present_mode() {
+	return present_mode;
+}
+
+static int draw_number(const unsigned int xi, const unsigned int yi, const unsigned int color, unsigned long number, const unsigned int size) {
 
 	/*
 	 *  -0-
@@ -252,7 +872,7 @@ int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned
 	if(BIT0(mask)) {
 		x += default_width;
 		for(; width < default_width; width++, y++) {
-			if(vg_draw_line(x, y, x+size, y, color) == -1) {
+			if(draw_line(x, y, x+size, y, color) == -1) {
 				return -1;
 			}
 		}
@@ -264,7 +884,7 @@ int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned
 		x += default_width;
 		y += default_width + size;
 		for(; width < default_width; width++, y++) {
-			if(vg_draw_line(x, y, x+size, y, color) == -1) {
+			if(draw_line(x, y, x+size, y, color) == -1) {
 				return -1;
 			}
 		}
@@ -276,7 +896,7 @@ int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned
 		x += default_width;
 		y += 2*default_width + 2*size;
 		for(; width < default_width; width++, y++) {
-			if(vg_draw_line(x, y, x+size, y, color) == -1) {
+			if(draw_line(x, y, x+size, y, color) == -1) {
 				return -1;
 			}
 		}
@@ -288,7 +908,7 @@ int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned
 	if(BIT1(mask)) {
 		y += default_width;
 		for(; width < default_width; width++, x++) {
-			if(vg_draw_line(x, y, x, y+size, color) == -1) {
+			if(draw_line(x, y, x, y+size, color) == -1) {
 				return -1;
 			}
 		}
@@ -299,7 +919,7 @@ int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned
 	if(BIT4(mask)) {
 		y += 2*default_width + size;
 		for(; width < default_width; width++, x++) {
-			if(vg_draw_line(x, y, x, y+size, color) == -1) {
+			if(draw_line(x, y, x, y+size, color) == -1) {
 				return -1;
 			}
 		}
@@ -311,7 +931,7 @@ int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned
 		x += default_width + size;
 		y += default_width;
 		for(; width < default_width; width++, x++) {
-			if(vg_draw_line(x, y, x, y+size, color) == -1) {
+			if(draw_line(x, y, x, y+size, color) == -1) {
 				return -1;
 			}
 		}
@@ -323,7 +943,7 @@ int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned
 		x += default_width + size;
 		y += 2*default_width + size;
 		for(; width < default_width; width++, x++) {
-			if(vg_draw_line(x, y, x, y+size, color) == -1) {
+			if(draw_line(x, y, x, y+size, color) == -1) {
 				return -1;
 			}
 		}
@@ -335,7 +955,7 @@ int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned
 	return (size);
 }
 
-int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned int color, const char symbol, const unsigned int size) {
+static int draw_special(const unsigned int xi, const unsigned int yi, const unsigned int color, const char symbol, const unsigned int size) {
 	unsigned long Hmask = 0x0;
 	unsigned long Vmask = 0x0;
 
@@ -359,7 +979,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 	if(Hmask) {
 		if(BIT0(Hmask)) {
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -370,7 +990,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT1(Hmask)) {
 			x += size;
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -381,7 +1001,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT2(Hmask)) {
 			y += size;
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -393,7 +1013,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 			x += size + default_width;
 			y += size;
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -404,7 +1024,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT4(Hmask)) {
 			y += 2*size;
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -416,7 +1036,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 			x += size;
 			y += 2*size;
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -427,7 +1047,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT6(Hmask)) {
 			y += 3*size;
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -439,7 +1059,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 			x += size;
 			y += 3*size;
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -450,7 +1070,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT8(Hmask)) {
 			y += 4*size;
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -462,7 +1082,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 			x += size;
 			y += 4*size;
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x, y, x+size, y, color) == -1) {
+				if(draw_line(x, y, x+size, y, color) == -1) {
 					return -1;
 				}
 			}
@@ -475,7 +1095,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 	if(Vmask) {
 		if(BIT0(Vmask)) {
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+size, color) == -1) {
+				if(draw_line(x, y, x, y+size, color) == -1) {
 					return -1;
 				}
 			}
@@ -486,7 +1106,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT1(Vmask)) {
 			x += 2*size;
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+size, color) == -1) {
+				if(draw_line(x, y, x, y+size, color) == -1) {
 					return -1;
 				}
 			}
@@ -497,7 +1117,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT2(Vmask)) {
 			y += size;
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+size, color) == -1) {
+				if(draw_line(x, y, x, y+size, color) == -1) {
 					return -1;
 				}
 			}
@@ -509,7 +1129,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 			x += 2*size;
 			y += size;
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+size, color) == -1) {
+				if(draw_line(x, y, x, y+size, color) == -1) {
 					return -1;
 				}
 			}
@@ -520,7 +1140,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT4(Vmask)) {
 			y += 2*size;
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+size, color) == -1) {
+				if(draw_line(x, y, x, y+size, color) == -1) {
 					return -1;
 				}
 			}
@@ -532,7 +1152,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 			x += 2*size;
 			y += 2*size;
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+size, color) == -1) {
+				if(draw_line(x, y, x, y+size, color) == -1) {
 					return -1;
 				}
 			}
@@ -543,7 +1163,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT6(Vmask)) {
 			y += 3*size;
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+size, color) == -1) {
+				if(draw_line(x, y, x, y+size, color) == -1) {
 					return -1;
 				}
 			}
@@ -555,7 +1175,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 			x += 2*size;
 			y += 3*size;
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+size, color) == -1) {
+				if(draw_line(x, y, x, y+size, color) == -1) {
 					return -1;
 				}
 			}
@@ -566,7 +1186,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 		if(BIT8(Vmask)) {
 			x += size;
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+2*size, color) == -1) {
+				if(draw_line(x, y, x, y+2*size, color) == -1) {
 					return -1;
 				}
 			}
@@ -578,7 +1198,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 			x += size;
 			y += 2*size;
 			for(; width < default_width; width++, x++) {
-				if(vg_draw_line(x, y, x, y+2*size, color) == -1) {
+				if(draw_line(x, y, x, y+2*size, color) == -1) {
 					return -1;
 				}
 			}
@@ -591,7 +1211,7 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
 	return 0;
 }
 
-int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, const char symbol, const unsigned int size) {
+static int draw_char(unsigned int xi, unsigned int yi, const unsigned int color, const char symbol, const unsigned int size) {
 
 	int number_code = 48;
 	int to_lower = 97;
@@ -611,11 +1231,11 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 	unsigned int width = 0;
 
 	if((symbol >= '0') && (symbol <= '9')) {
-		return vg_draw_number(xi,yi,color,((unsigned int)(symbol) - number_code), 2*size);
+		return draw_number(xi,yi,color,((unsigned int)(symbol) - number_code), 2*size);
 	}
 
 	if((symbol == '(') || (symbol == '\'') || (symbol == ')')) {
-		return vg_draw_special(xi,yi,color,symbol,size);
+		return draw_special(xi,yi,color,symbol,size);
 	}
 
 	switch(((int)(symbol) - to_lower)) {
@@ -738,7 +1358,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 		y += 2*size;
 		if(dot) {
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x+size, y-size, x+size+default_width, y-size, color) == -1) {
+				if(draw_line(x+size, y-size, x+size+default_width, y-size, color) == -1) {
 					return -1;
 				}
 			}
@@ -750,7 +1370,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 	else {
 		if(dot) {
 			for(; width < default_width; width++, y++) {
-				if(vg_draw_line(x+size, y+size, x+size+default_width, y+size, color) == -1) {
+				if(draw_line(x+size, y+size, x+size+default_width, y+size, color) == -1) {
 					return -1;
 				}
 			}
@@ -769,7 +1389,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 		if(Hmask) {
 			if(BIT0(Hmask)) {
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -780,7 +1400,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT1(Hmask)) {
 				x += size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -791,7 +1411,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT2(Hmask)) {
 				y += size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -803,7 +1423,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 				x += size + default_width;
 				y += size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -814,7 +1434,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT4(Hmask)) {
 				y += 2*size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -826,7 +1446,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 				x += size;
 				y += 2*size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -837,7 +1457,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT6(Hmask)) {
 				y += 3*size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -849,7 +1469,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 				x += size;
 				y += 3*size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -860,7 +1480,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT8(Hmask)) {
 				y += 4*size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -872,7 +1492,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 				x += size;
 				y += 4*size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y, color) == -1) {
+					if(draw_line(x, y, x+size, y, color) == -1) {
 						return -1;
 					}
 				}
@@ -885,7 +1505,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 		if(Vmask) {
 			if(BIT0(Vmask)) {
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+size, color) == -1) {
+					if(draw_line(x, y, x, y+size, color) == -1) {
 						return -1;
 					}
 				}
@@ -896,7 +1516,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT1(Vmask)) {
 				x += 2*size;
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+size, color) == -1) {
+					if(draw_line(x, y, x, y+size, color) == -1) {
 						return -1;
 					}
 				}
@@ -907,7 +1527,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT2(Vmask)) {
 				y += size;
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+size, color) == -1) {
+					if(draw_line(x, y, x, y+size, color) == -1) {
 						return -1;
 					}
 				}
@@ -919,7 +1539,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 				x += 2*size;
 				y += size;
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+size, color) == -1) {
+					if(draw_line(x, y, x, y+size, color) == -1) {
 						return -1;
 					}
 				}
@@ -930,7 +1550,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT4(Vmask)) {
 				y += 2*size;
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+size, color) == -1) {
+					if(draw_line(x, y, x, y+size, color) == -1) {
 						return -1;
 					}
 				}
@@ -942,7 +1562,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 				x += 2*size;
 				y += 2*size;
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+size, color) == -1) {
+					if(draw_line(x, y, x, y+size, color) == -1) {
 						return -1;
 					}
 				}
@@ -953,7 +1573,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT6(Vmask)) {
 				y += 3*size;
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+size, color) == -1) {
+					if(draw_line(x, y, x, y+size, color) == -1) {
 						return -1;
 					}
 				}
@@ -965,7 +1585,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 				x += 2*size;
 				y += 3*size;
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+size, color) == -1) {
+					if(draw_line(x, y, x, y+size, color) == -1) {
 						return -1;
 					}
 				}
@@ -976,7 +1596,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT8(Vmask)) {
 				x += size;
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+2*size, color) == -1) {
+					if(draw_line(x, y, x, y+2*size, color) == -1) {
 						return -1;
 					}
 				}
@@ -988,7 +1608,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 				x += size;
 				y += 2*size;
 				for(; width < default_width; width++, x++) {
-					if(vg_draw_line(x, y, x, y+2*size, color) == -1) {
+					if(draw_line(x, y, x, y+2*size, color) == -1) {
 						return -1;
 					}
 				}
@@ -1003,7 +1623,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 				y += 2*size;
 				x += default_width;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+size, y-size, color) == -1) {
+					if(draw_line(x, y, x+size, y-size, color) == -1) {
 						return -1;
 					}
 				}
@@ -1014,7 +1634,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT1(Dmask)) {
 				y += 4*size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+2*size, y-2*size, color) == -1) {
+					if(draw_line(x, y, x+2*size, y-2*size, color) == -1) {
 						return -1;
 					}
 				}
@@ -1025,7 +1645,7 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 			if(BIT2(Dmask)) {
 				y += 2*size;
 				for(; width < default_width; width++, y++) {
-					if(vg_draw_line(x, y, x+2*size, y+2*size, color) == -1) {
+					if(draw_line(x, y, x+2*size, y+2*size, color) == -1) {
 						return -1;
 					}
 				}
@@ -1043,103 +1663,380 @@ int vg_draw_char(unsigned int xi, unsigned int yi, const unsigned int color, con
 	else return (size/2);
 }
 
-int vg_draw_line(unsigned int xi, unsigned int yi, unsigned int xf, unsigned int yf, unsigned int color) {
+static void number_extent(const unsigned int size, unsigned int *width, unsigned int *height) {
+	*width = size + 2*default_width + 1;
+	*height = 2*size + 3*default_width + 1;
+}
 
-	unsigned long i;
-	long double deltax;
-	long double deltay;
-	long double m;
-	long double b;
+static void char_extent(const unsigned int size, unsigned int *width, unsigned int *height) {
+	/* covers the widest ('m', 'w') and lowered glyphs, as well as numbers and specials */
+	*width = 4*size + 2*default_width + 1;
+	*height = 6*size + 2*default_width + 1;
+}
 
-	/* Verifications */
-	if((yi >= v_res) || (yf >= v_res) || (xf >= h_res) || (xi >= h_res)) {
-		return -1;
+void vg_number_extent(const unsigned int size, unsigned int *width, unsigned int *height) {
+	number_extent(glyph_size(size), width, height);
+	*width *= scale;
+	*height *= scale;
+}
+
+void vg_char_extent(const unsigned int size, unsigned int *width, unsigned int *height) {
+	char_extent(glyph_size(size), width, height);
+	*width *= scale;
+	*height *= scale;
+}
+
+int vg_draw_number(const unsigned int xi, const unsigned int yi, const unsigned int color, unsigned long number, const unsigned int size) {
+	unsigned int width, height, s = glyph_size(size);
+	int x = to_buffer(xi), y = to_buffer(yi);
+	int ret;
+
+	number_extent(s, &width, &height);
+	damage_add(x, y, x + width, y + height);
+	damage_suspended++;
+	ret = draw_number(x, y, color, number, s);
+	damage_suspended--;
+
+	return (ret == -1) ? -1 : ret * (int)scale;
+}
+
+int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned int color, const char symbol, const unsigned int size) {
+	unsigned int s = glyph_size(size);
+	int x = to_buffer(xi), y = to_buffer(yi);
+	int ret;
+
+	damage_add(x, y, x + 2*s + default_width + 1, y + 4*s + default_width + 1);
+	damage_suspended++;
+	ret = draw_special(x, y, color, symbol, s);
+	damage_suspended--;
+
+	return (ret == -1) ? -1 : ret * (int)scale;
+}
+
+int vg_draw_char(const unsigned int xi, const unsigned int yi, const unsigned int color, const char symbol, const unsigned int size) {
+	unsigned int width, height, s = glyph_size(size);
+	int x = to_buffer(xi), y = to_buffer(yi);
+	int ret;
+
+	char_extent(s, &width, &height);
+	damage_add(x, y, x + width, y + height);
+	damage_suspended++;
+	ret = draw_char(x, y, color, symbol, s);
+	damage_suspended--;
+
+	return (ret == -1) ? -1 : ret * (int)scale;
+}
+
+/**
+ * @brief Copy pixels to the target; with overdraw counting, count a write on each instead.
+ */
+static void copy_pixels(unsigned char *dst, const unsigned char *src, unsigned long count) {
+	if(overdraw) {
+		format->span(dst, 0, count);
 	}
+	else {
+		memcpy(dst, src, count * bytes_per_pixel);
+	}
+}
 
-	/* Verifications END*/
+int vg_draw_runs(int x, int y, const vg_runs_t *image) {
+	const vg_run_t *run = image->runs;
+	const vg_run_t *end = image->runs + image->count;
+	int rx, ry, len, skip;
 
-	deltax = (long double)(xf) - (long double)(xi);
-	deltay = (long double)(yf) - (long double)(yi);
-	m = deltay/deltax;
-	b = (long double)(yi) - m*xi;
+	x = to_buffer(x);
+	y = to_buffer(y);
 
-	if(xi == xf) { /* draw vertical line */
-		if(yf < yi) {
-			swap(&xi,&xf);
-			swap(&yi,&yf);
-		}
-		for(i = yi; i <= yf; i++) {
-			vg_set_pixel(xi,i,color);
+	if((x >= clip.x2) || (y >= clip.y2) || (x + (int)image->width <= clip.x1) || (y + (int)image->height <= clip.y1)) {
+		return 0;
+	}
+
+	damage_add(x, y, x + image->width, y + image->height);
+
+	if((x >= clip.x1) && (y >= clip.y1) && (x + (int)image->width <= clip.x2) && (y + (int)image->height <= clip.y2)) {
+		for(; run < end; run++) {
+			copy_pixels(PIXEL(x + run->x, y + run->y), run->pixels, run->len);
 		}
+		return 0;
 	}
-	else if(yi == yf) { /* draw horizontal line */
-		if(xf < xi) {
-			swap(&xi,&xf);
-			swap(&yi,&yf);
+
+	/* partially visible: clip each run */
+	for(; run < end; run++) {
+		rx = x + run->x;
+		ry = y + run->y;
+		len = run->len;
+		if((ry < clip.y1) || (ry >= clip.y2)) {
+			continue;
+		}
+		skip = (rx < clip.x1) ? clip.x1 - rx : 0;
+		if(rx + len > clip.x2) {
+			len = clip.x2 - rx;
 		}
-		for(i = xi; i <= xf ; i++) {
-			vg_set_pixel(i,yi,color);
+		if(len <= skip) {
+			continue;
 		}
+		copy_pixels(PIXEL(rx + skip, ry), run->pixels + skip * bytes_per_pixel, len - skip);
 	}
-	//***********************************************
-	//   		USED ONLY FOR CHARACTERS
-	//***********************************************
-	else if(m == 1) {
+
+	return 0;
+}
+
+int vg_blit_surface(const vg_surface_t *surface, int x, int y) {
+	int x1, y1, x2, y2;
+	unsigned long row_pixels;
+	const unsigned char *src;
+	unsigned char *dst;
+
+	x = to_buffer(x);
+	y = to_buffer(y);
+	x1 = (x < clip.x1) ? clip.x1 : x;
+	y1 = (y < clip.y1) ? clip.y1 : y;
+	x2 = x + (int)surface->width;
+	y2 = y + (int)surface->height;
+
+	if(x2 > clip.x2) {
+		x2 = clip.x2;
+	}
+	if(y2 > clip.y2) {
+		y2 = clip.y2;
+	}
+	if((x1 >= x2) || (y1 >= y2)) {
+		return 0;
+	}
+
+	damage_add(x1, y1, x2, y2);
+
+	row_pixels = x2 - x1;
+	src = surface->pixels + (y1 - y)*surface->pitch + (x1 - x)*bytes_per_pixel;
+	dst = PIXEL(x1, y1);
+	for(; y1 < y2; y1++) {
+		copy_pixels(dst, src, row_pixels);
+		src += surface->pitch;
+		dst += pitch;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Copy a section of a surface to memory, clipped to the surface.
+ *
+ * Coordinates are in buffer pixels; dst holds the pixel at (x1,y1) and
+ * pixels of dst outside of the surface are left untouched.
+ */
+static void copy_out(const vg_surface_t *source, int x1, int y1, int x2, int y2, unsigned char *dst, unsigned long dst_pitch) {
+	unsigned int bytes;
+	int cx1 = (x1 < 0) ? 0 : x1;
+	int cy1 = (y1 < 0) ? 0 : y1;
+	int cx2 = (x2 > (int)source->width) ? (int)source->width : x2;
+	int cy2 = (y2 > (int)source->height) ? (int)source->height : y2;
+	unsigned long row_bytes;
+	const unsigned char *src;
+
+	/* also when no mode is set, and the screen has no format */
+	if((cx1 >= cx2) || (cy1 >= cy2)) {
+		return;
+	}
+
+	bytes = source->format->bytes_per_pixel;
+	row_bytes = (cx2 - cx1) * bytes;
+	src = source->pixels + cy1*source->pitch + cx1*bytes;
+	dst += (cy1 - y1)*dst_pitch + (cx1 - x1)*bytes;
+
+	/* whole rows of the same pitch are one block */
+	if((row_bytes == source->pitch) && (dst_pitch == source->pitch)) {
+		memcpy(dst, src, row_bytes * (cy2 - cy1));
+		return;
+	}
+	for(; cy1 < cy2; cy1++) {
+		memcpy(dst, src, row_bytes);
+		src += source->pitch;
+		dst += dst_pitch;
+	}
+}
+
+int vg_read_surface(vg_surface_t *surface, int x, int y) {
+	x = to_buffer(x);
+	y = to_buffer(y);
+	copy_out(target, x, y, x + (int)surface->width, y + (int)surface->height, surface->pixels, surface->pitch);
+
+	return 0;
+}
+
+int vg_read_rect(const vg_surface_t *source, const vg_rect_t *rect, unsigned char *pixels, unsigned long pixels_pitch) {
+	if(source == NULL) {
+		source = &screen;
+	}
+	if((rect->x1 >= rect->x2) || (rect->y1 >= rect->y2)) {
+		return -1;
+	}
+
+	copy_out(source, to_buffer(rect->x1), to_buffer(rect->y1), to_buffer_up(rect->x2), to_buffer_up(rect->y2), pixels, pixels_pitch);
+
+	return 0;
+}
+
+/**
+ * @brief Narrow [first, last] to the steps i whose coordinate start + sign*i is in [low, high).
+ */
+static void clip_steps(int start, int sign, int low, int high, long *first, long *last) {
+	long from, to;
+
+	if(sign > 0) {
+		from = (long)low - start;
+		to = (long)high - 1 - start;
+	}
+	else {
+		from = (long)start - high + 1;
+		to = (long)start - low;
+	}
+
+	*first = (from > *first) ? from : *first;
+	*last = (to < *last) ? to : *last;
+}
+
+int vg_draw_line(int xi, int yi, int xf, int yf, unsigned int color) {
+	return draw_line(to_buffer(xi), to_buffer(yi), to_buffer(xf), to_buffer(yf), color);
+}
+
+/**
+ * @brief Draw a line, in buffer coordinates.
+ */
+static int draw_line(int xi, int yi, int xf, int yf, unsigned int color) {
+
+	int t, sx, sy, x_major, minor_start, minor_sign, minor_low, minor_high;
+	long first, last, major, minor, from, to, err;
+	long major_stride, minor_stride;
+	long long num;
+	uint32_t pixel;
+
+	if((clip.x1 >= clip.x2) || (clip.y1 >= clip.y2)) {
+		return 0;
+	}
+
+	damage_add((xi < xf) ? xi : xf, (yi < yf) ? yi : yf,
+			((xi > xf) ? xi : xf) + 1, ((yi > yf) ? yi : yf) + 1);
+
+	pixel = pixfmt_map(color);
+
+	if(yi == yf) { /* draw horizontal line */
 		if(xf < xi) {
-			swap(&xi,&xf);
-			swap(&yi,&yf);
+			t = xi; xi = xf; xf = t;
+		}
+		if((yi < clip.y1) || (yi >= clip.y2)) {
+			return 0;
 		}
-		for(; xi < xf; xi++, yi++) {
-			vg_set_pixel(xi,yi,color);
+		xi = (xi < clip.x1) ? clip.x1 : xi;
+		xf = (xf >= clip.x2) ? clip.x2 - 1 : xf;
+		if(xi <= xf) {
+			format->span(PIXEL(xi, yi), pixel, xf - xi + 1);
 		}
+		return 0;
 	}
-	else if(m == -1) {
-		if(xf < xi) {
-			swap(&xi,&xf);
-			swap(&yi,&yf);
+
+	if(xi == xf) { /* draw vertical line */
+		if(yf < yi) {
+			t = yi; yi = yf; yf = t;
+		}
+		if((xi < clip.x1) || (xi >= clip.x2)) {
+			return 0;
 		}
-		for(; xi <= xf; xi++, yi--) {
-			vg_set_pixel(xi,yi,color);
+		yi = (yi < clip.y1) ? clip.y1 : yi;
+		yf = (yf >= clip.y2) ? clip.y2 - 1 : yf;
+		if(yi <= yf) {
+			format->step(PIXEL(xi, yi), pixel, yf - yi + 1, pitch);
 		}
+		return 0;
 	}
+
 	//***********************************************
-	else if(fabs(m) < 1) {
+	//   		USED ONLY FOR CHARACTERS
+	//***********************************************
+	if(abs(xf - xi) == abs(yf - yi)) {
 		if(xf < xi) {
-					swap(&xi,&xf);
-					swap(&yi,&yf);
-				}
-		vg_set_pixel(xi,yi,color);
-		while(xi <= xf) {
-			if(m*xi + b > yi + 0.5) {
-				if(m > 0)
-					yi++;
-				else
-					yi--;
-			}
-			xi++;
-			vg_set_pixel(xi,yi,color);
+			t = xi; xi = xf; xf = t;
+			t = yi; yi = yf; yf = t;
 		}
-	}
-	//***********************************************
-	else if(fabs(m) > 1) {
-		if(yf < yi) {
-				swap(&xi,&xf);
-				swap(&yi,&yf);
-			}
-		m = 1.0/m;
-		vg_set_pixel(xi,yi,color);
-		while(yi <= yf) {
-			if(((yi - b)*m) < (xi + 0.5))
-				if(m > 0)
-					xi++;
-				else
-					xi--;
-			yi++;
-			vg_set_pixel(xi,yi,color);
+		/* the glyphs were designed with lines of slope 1 stopping short of their final point */
+		sy = (yf > yi) ? 1 : -1;
+		first = 0;
+		last = (sy > 0) ? (xf - xi - 1) : (xf - xi);
+		clip_steps(xi, 1, clip.x1, clip.x2, &first, &last);
+		clip_steps(yi, sy, clip.y1, clip.y2, &first, &last);
+		if(first <= last) {
+			format->step(PIXEL(xi + first, yi + sy*first), pixel, last - first + 1, sy*(long)pitch + bytes_per_pixel);
 		}
+		return 0;
 	}
 	//***********************************************
 
+	/*
+	 * Bresenham along the major axis: step i moves the minor axis by
+	 * floor((2*i*minor + major) / (2*major)), so the visible steps and the error
+	 * at the first one are computed once and the loop needs no checks.
+	 */
+	sx = (xf > xi) ? 1 : -1;
+	sy = (yf > yi) ? 1 : -1;
+	x_major = abs(xf - xi) > abs(yf - yi);
+	if(x_major) {
+		major = abs(xf - xi);
+		minor = abs(yf - yi);
+		minor_start = yi;
+		minor_sign = sy;
+		major_stride = sx * (long)bytes_per_pixel;
+		minor_stride = sy * (long)pitch;
+		first = 0;
+		last = major;
+		clip_steps(xi, sx, clip.x1, clip.x2, &first, &last);
+		minor_low = clip.y1;
+		minor_high = clip.y2;
+	}
+	else {
+		major = abs(yf - yi);
+		minor = abs(xf - xi);
+		minor_start = xi;
+		minor_sign = sx;
+		major_stride = sy * (long)pitch;
+		minor_stride = sx * (long)bytes_per_pixel;
+		first = 0;
+		last = major;
+		clip_steps(yi, sy, clip.y1, clip.y2, &first, &last);
+		minor_low = clip.x1;
+		minor_high = clip.x2;
+	}
+
+	/* minor offsets inside the clip rectangle, as steps */
+	from = 0;
+	to = major;
+	clip_steps(minor_start, minor_sign, minor_low, minor_high, &from, &to);
+	if(to < 0) {
+		return 0;
+	}
+	num = 2LL*major*from - major;
+	if(num > 0) {
+		t = (num + 2*minor - 1) / (2*minor);
+		first = (t > first) ? t : first;
+	}
+	num = 2LL*major*(to + 1) - major - 1;
+	last = (num / (2*minor) < last) ? (long)(num / (2*minor)) : last;
+
+	if(first > last) {
+		return 0;
+	}
+
+	/* first visible pixel */
+	num = 2LL*first*minor + major;
+	err = num % (2*major);
+	if(x_major) {
+		xi += sx*first;
+		yi += sy*(long)(num / (2*major));
+	}
+	else {
+		xi += sx*(long)(num / (2*major));
+		yi += sy*first;
+	}
+	format->line(PIXEL(xi, yi), pixel, last - first + 1, err, 2*minor, 2*major, major_stride, minor_stride);
+
 	return 0;
 }
 
@@ -1187,11 +2084,7 @@ int vg_draw_rectangle(unsigned int xi, unsigned int yi, unsigned int xf, unsigne
 	return 0;
 }
 
-int vg_draw_death_square(unsigned int xi, unsigned int yi, unsigned int size, unsigned int color[]) {
-
-	if(!size) {
-		return -2;
-	}
+static int draw_death_square(unsigned int xi, unsigned int yi, unsigned int size, unsigned int color[]) {
 
 	/* horizontal */
 	// upper left line
@@ -1235,21 +2128,223 @@ int vg_draw_death_square(unsigned int xi, unsigned int yi, unsigned int size, un
 
 }
 
+int vg_draw_death_square(unsigned int xi, unsigned int yi, unsigned int size, unsigned int color[]) {
+	int ret;
+
+	if(!size) {
+		return -2;
+	}
+
+	vg_mark_damage(xi, yi, xi + size + 1, yi + size + 1);
+	damage_suspended++;
+	ret = draw_death_square(xi, yi, size, color);
+	damage_suspended--;
+
+	return ret;
+}
+
 int vg_fill_section(unsigned int xi, unsigned int yi, unsigned int xf, unsigned int yf, unsigned int color) {
-	unsigned long col;
-	unsigned int x = xi;
-	unsigned int y = yi;
+	return vg_fill_rect(xi, yi, xf, yf, color);
+}
+
+int vg_fill_rects(const vg_fill_t *fills, unsigned int count) {
+	unsigned int i;
+	int x1, y1, x2, y2, y;
+	unsigned long row_pixels;
+	uint32_t pixel;
+	unsigned char *ptr;
+
+	for(i = 0; i < count; i++) {
+		/* edges round the same way, so rectangles sharing one still tile */
+		x1 = to_buffer(fills[i].rect.x1);
+		y1 = to_buffer(fills[i].rect.y1);
+		x2 = to_buffer(fills[i].rect.x2);
+		y2 = to_buffer(fills[i].rect.y2);
+		x1 = (x1 < clip.x1) ? clip.x1 : x1;
+		y1 = (y1 < clip.y1) ? clip.y1 : y1;
+		x2 = (x2 > clip.x2) ? clip.x2 : x2;
+		y2 = (y2 > clip.y2) ? clip.y2 : y2;
+
+		if((x1 >= x2) || (y1 >= y2)) {
+			continue;
+		}
+
+		damage_add(x1, y1, x2, y2);
+
+		pixel = pixfmt_map(fills[i].color);
+		row_pixels = x2 - x1;
+		ptr = PIXEL(x1, y1);
+
+		if(row_pixels * bytes_per_pixel == pitch) { /* full unpadded rows are contiguous */
+			format->span(ptr, pixel, row_pixels * (y2 - y1));
+			continue;
+		}
 
-	if((yf >= v_res) || (xf >= h_res)) {
+		for(y = y1; y < y2; y++, ptr += pitch) {
+			format->span(ptr, pixel, row_pixels);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Walk a polygon edge with integer steps, widening the span of every row it crosses.
+ *
+ * Rows are relative to ymin. Each row keeps the ceiling of the leftmost and the
+ * floor of the rightmost crossing, which are the first and last pixels inside.
+ */
+static void polygon_edge(const vg_point_t *a, const vg_point_t *b, int ymin, int ymax) {
+	int y, x, dx, dy, step, rem, err, xceil, first, last;
+	long long skipped;
+
+	if(a->y > b->y) {
+		const vg_point_t *t = a;
+		a = b;
+		b = t;
+	}
+
+	dx = b->x - a->x;
+	dy = b->y - a->y;
+
+	if(dy == 0) { /* horizontal edge */
+		if((a->y >= ymin) && (a->y <= ymax)) {
+			y = a->y - ymin;
+			x = (a->x < b->x) ? a->x : b->x;
+			if(x < span_left[y]) {
+				span_left[y] = x;
+			}
+			x = (a->x > b->x) ? a->x : b->x;
+			if(x > span_right[y]) {
+				span_right[y] = x;
+			}
+		}
+		return;
+	}
+
+	/* x = a->x + (y - a->y) * dx / dy, as floor x plus err/dy */
+	step = dx / dy;
+	rem = dx % dy;
+	if(rem < 0) {
+		step--;
+		rem += dy;
+	}
+
+	/* only the rows inside the clip rectangle: jump to the first one */
+	first = (a->y < ymin) ? ymin : a->y;
+	last = (b->y > ymax) ? ymax : b->y;
+	if(first > last) {
+		return;
+	}
+	skipped = (long long)(first - a->y) * rem;
+	x = a->x + (first - a->y) * step + (int)(skipped / dy);
+	err = (int)(skipped % dy);
+
+	for(y = first; y <= last; y++) {
+		xceil = x + (err != 0);
+		if(xceil < span_left[y - ymin]) {
+			span_left[y - ymin] = xceil;
+		}
+		if(x > span_right[y - ymin]) {
+			span_right[y - ymin] = x;
+		}
+		x += step;
+		err += rem;
+		if(err >= dy) {
+			x++;
+			err -= dy;
+		}
+	}
+}
+
+int vg_fill_polygon(const vg_point_t *points, unsigned int count, unsigned int color) {
+	unsigned int i;
+	int xmin, xmax, ymin, ymax, y, x1, x2;
+	uint32_t pixel = pixfmt_map(color);
+	unsigned char *row;
+
+	if(count == 0) {
 		return -1;
 	}
 
-	for (; y < yf; y++) {
-		for (; x < xf; x++) {
-			vg_set_pixel(x,y,color);
+	if(scale > 1) {
+		if(count > scaled_count) {
+			free(scaled_points);
+			if((scaled_points = malloc(count * sizeof(vg_point_t))) == NULL) {
+				scaled_count = 0;
+				return -1;
+			}
+			scaled_count = count;
+		}
+		for(i = 0; i < count; i++) {
+			scaled_points[i].x = to_buffer(points[i].x);
+			scaled_points[i].y = to_buffer(points[i].y);
+		}
+		points = scaled_points;
+	}
+
+	xmin = xmax = points[0].x;
+	ymin = ymax = points[0].y;
+	for(i = 1; i < count; i++) {
+		xmin = (points[i].x < xmin) ? points[i].x : xmin;
+		xmax = (points[i].x > xmax) ? points[i].x : xmax;
+		ymin = (points[i].y < ymin) ? points[i].y : ymin;
+		ymax = (points[i].y > ymax) ? points[i].y : ymax;
+	}
+
+	/* clip the rows once */
+	ymin = (ymin < clip.y1) ? clip.y1 : ymin;
+	ymax = (ymax >= clip.y2) ? clip.y2 - 1 : ymax;
+	if((ymin > ymax) || (xmax < clip.x1) || (xmin >= clip.x2)) {
+		return 0;
+	}
+
+	if((unsigned int)(ymax - ymin + 1) > span_rows) {
+		free(span_left);
+		free(span_right);
+		span_rows = ymax - ymin + 1;
+		span_left = malloc(span_rows * sizeof(int));
+		span_right = malloc(span_rows * sizeof(int));
+		if((span_left == NULL) || (span_right == NULL)) {
+			free(span_left);
+			free(span_right);
+			span_left = span_right = NULL;
+			span_rows = 0;
+			return -1;
+		}
+	}
+
+	for(y = 0; y <= ymax - ymin; y++) {
+		span_left[y] = xmax + 1;
+		span_right[y] = xmin - 1;
+	}
+
+	for(i = 0; i < count; i++) {
+		polygon_edge(&points[i], &points[(i + 1) % count], ymin, ymax);
+	}
+
+	damage_add(xmin, ymin, xmax + 1, ymax + 1);
+
+	row = PIXEL(0, ymin);
+	for(y = 0; y <= ymax - ymin; y++, row += pitch) {
+		x1 = (span_left[y] < clip.x1) ? clip.x1 : span_left[y];
+		x2 = (span_right[y] >= clip.x2) ? clip.x2 - 1 : span_right[y];
+		if(x1 <= x2) {
+			format->span(row + x1*bytes_per_pixel, pixel, x2 - x1 + 1);
 		}
-		x = xi;
 	}
 
 	return 0;
 }
+
+int vg_fill_rect(int x1, int y1, int x2, int y2, unsigned int color) {
+	vg_fill_t fill;
+
+	fill.rect.x1 = x1;
+	fill.rect.y1 = y1;
+	fill.rect.x2 = x2;
+	fill.rect.y2 = y2;
+	fill.color = color;
+
+	return vg_fill_rects(&fill, 1);
+}
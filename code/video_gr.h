@@ -2,6 +2,7 @@
 #define VIDEO_GR_H_
 
 #include "libraries.h"
+#include "pixfmt.h"
 
 /** @defgroup video_gr video_gr
  * @{
@@ -9,16 +10,244 @@
  * Functions related to the graphics and video buffer.
  */
 
+#define VG_DAMAGE_MAX_RECTS		16	/**< @brief Maximum number of damage rectangles tracked per frame */
+#define VG_DAMAGE_FULL_PERCENT	60	/**< @brief Damaged screen percentage above which the whole frame is presented */
+#define VG_BUFFER_ALIGN			64	/**< @brief Alignment of the video buffer and of each of its rows, in bytes (a cache line) */
+#define VG_MAX_RENDER_SCALE		4	/**< @brief Largest render scale accepted by vg_set_render_scale() */
+
+/** @name Present Modes */
+/**@{
+ *
+ * Ways of choosing what vg_draw_buffer_to_mem() copies to VRAM
+ */
+enum {
+	VG_PRESENT_DAMAGE,	/**< @brief copy the regions marked as damaged */
+	VG_PRESENT_DIFF		/**< @brief copy the blocks that differ from a shadow copy of VRAM */
+};
+/** @} end of Present Modes */
+
+/** @name Rectangle */
+/**@{
+ *
+ * Screen rectangle, [x1,x2[ x [y1,y2[ (final coordinates are exclusive)
+ */
+typedef struct {
+	int x1;	/**< @brief x initial coordinate */
+	int y1;	/**< @brief y initial coordinate */
+	int x2;	/**< @brief x final coordinate (exclusive) */
+	int y2;	/**< @brief y final coordinate (exclusive) */
+} vg_rect_t;
+/** @} end of Rectangle */
+
+/** @name Point */
+/**@{
+ *
+ * Screen point
+ */
+typedef struct {
+	int x;	/**< @brief x coordinate */
+	int y;	/**< @brief y coordinate */
+} vg_point_t;
+/** @} end of Point */
+
+/** @name Fill */
+/**@{
+ *
+ * Rectangle to be filled with a color
+ */
+typedef struct {
+	vg_rect_t rect;		/**< @brief region to fill */
+	unsigned int color;	/**< @brief fill color */
+} vg_fill_t;
+/** @} end of Fill */
+
+/** @name Surface */
+/**@{
+ *
+ * Pixel buffer: the video buffer, VRAM or an off-screen surface
+ */
+typedef struct {
+	unsigned char *pixels;		/**< @brief pixel data, row after row */
+	unsigned int width;			/**< @brief width in buffer pixels */
+	unsigned int height;		/**< @brief height in buffer pixels */
+	unsigned int pitch;			/**< @brief bytes from the start of a row to the start of the next */
+	const pixfmt_t *format;		/**< @brief pixel format */
+} vg_surface_t;
+/** @} end of Surface */
+
+/** @name Run */
+/**@{
+ *
+ * Horizontal run of opaque pixels
+ */
+typedef struct {
+	unsigned short x;				/**< @brief x offset of the first pixel */
+	unsigned short y;				/**< @brief y offset of the row */
+	unsigned short len;				/**< @brief number of pixels */
+	const unsigned char *pixels;	/**< @brief pixel data, len pixels */
+} vg_run_t;
+/** @} end of Run */
+
+/** @name Runs */
+/**@{
+ *
+ * Image stored as its opaque runs, transparent elsewhere
+ */
+typedef struct {
+	unsigned int width;		/**< @brief bounding box width, in buffer pixels */
+	unsigned int height;	/**< @brief bounding box height, in buffer pixels */
+	unsigned int count;		/**< @brief number of runs */
+	vg_run_t *runs;			/**< @brief runs, sorted by row */
+} vg_runs_t;
+/** @} end of Runs */
+
+/** @name Present Stats */
+/**@{
+ *
+ * Statistics on the last buffer to memory transposition
+ */
+typedef struct {
+	unsigned long frames;			/**< @brief number of presented frames */
+	unsigned long bytes_uploaded;	/**< @brief bytes copied to the video memory on the last frame */
+	unsigned long bytes_total;		/**< @brief bytes copied to the video memory since vg_init() */
+	unsigned int rects;				/**< @brief number of rectangles copied on the last frame */
+	unsigned int full_frame;		/**< @brief 1 if the last frame was presented whole, 0 otherwise */
+	unsigned long blocks_compared;	/**< @brief MEM_DIFF_BLOCK byte blocks compared with the shadow on the last frame (VG_PRESENT_DIFF) */
+	unsigned long blocks_written;	/**< @brief blocks copied to the video memory on the last frame (VG_PRESENT_DIFF) */
+} vg_present_stats_t;
+/** @} end of Present Stats */
+
+/** @name Overdraw Stats */
+/**@{
+ *
+ * Write counts of the last frame presented with overdraw counting
+ */
+typedef struct {
+	unsigned int max;			/**< @brief most writes to one pixel, at most 255 */
+	unsigned long writes;		/**< @brief pixel writes */
+	unsigned long covered;		/**< @brief pixels written at least once */
+	unsigned long pixels;		/**< @brief pixels of the video buffer */
+} vg_overdraw_stats_t;
+/** @} end of Overdraw Stats */
+
 /**
  * @brief Initialize video graphics mode.
  *
+ * Fails if the mode's resolution is not a multiple of the render scale.
+ *
  * @param mode mode to initialize
+ *
+ * @return 0 if success, -1 otherwise (e.g. a mode the adapter does not have)
  */
 int vg_init(unsigned short mode);
+/**
+ * @brief Select the render scale used by the next vg_init(). Defaults to 1.
+ *
+ * With a scale of n the video buffer is n times smaller than the screen in each
+ * direction and every buffer pixel is drawn as an n x n block on present.
+ * Coordinates and sizes passed to vg_* functions stay in screen pixels.
+ *
+ * @param factor screen pixels per buffer pixel, from 1 to VG_MAX_RENDER_SCALE
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int vg_set_render_scale(unsigned int factor);
+/**
+ * @brief Get the render scale of the current mode.
+ *
+ * Surfaces and run images are in buffer pixels, this many times smaller than the screen.
+ *
+ * @return screen pixels per buffer pixel
+ */
+unsigned int vg_get_render_scale();
+/**
+ * @brief Select whether the next vg_init() counts writes instead of drawing. Defaults to off.
+ *
+ * Every primitive then adds one to each pixel it writes, whatever the color.
+ * Presents show the counts of the frame as heat colors, from black for none to
+ * white for 7 or more, and reset them.
+ *
+ * @param enable 1 to count writes, 0 to draw
+ */
+void vg_set_overdraw(unsigned int enable);
+/**
+ * @brief Get whether writes are being counted.
+ *
+ * @return 1 if counting writes, 0 otherwise
+ */
+unsigned int vg_get_overdraw();
+/**
+ * @brief Get the write counts of the last present made with overdraw counting.
+ *
+ * @return pointer to the statistics
+ */
+const vg_overdraw_stats_t *vg_get_overdraw_stats();
 /**
  * @brief Exit video graphics mode.
  */
 int vg_exit();
+/**
+ * @brief Get the number of bytes per pixel of the video buffer and surfaces.
+ *
+ * @return bytes per pixel
+ */
+unsigned int vg_get_bytes_per_pixel();
+/**
+ * @brief Convert an indexed color to a pixel of the current mode.
+ *
+ * 8 bpp modes keep the index; direct color modes get the default VGA palette color.
+ *
+ * @param color indexed color
+ *
+ * @return pixel value, vg_get_bytes_per_pixel() bytes little-endian
+ */
+uint32_t vg_map_color(unsigned int color);
+/**
+ * @brief Create an off-screen surface, cleared to color 0.
+ *
+ * The size is in screen pixels; the surface is as large as the buffer pixels covering it.
+ *
+ * @param width surface width
+ * @param height surface height
+ *
+ * @return pointer to the surface, NULL if out of memory
+ */
+vg_surface_t *vg_surface_create(unsigned int width, unsigned int height);
+/**
+ * @brief Free a surface created with vg_surface_create().
+ *
+ * @param surface surface to free
+ */
+void vg_surface_destroy(vg_surface_t *surface);
+/**
+ * @brief Redirect all drawing primitives to a surface.
+ *
+ * Drawing to a surface does not mark damage on the video buffer.
+ *
+ * @param surface surface to draw to, NULL for the video buffer
+ */
+void vg_set_target(vg_surface_t *surface);
+/**
+ * @brief Get the surface being drawn to.
+ *
+ * @return the surface, NULL for the video buffer
+ */
+vg_surface_t *vg_get_target();
+/**
+ * @brief Restrict drawing to a rectangle of the current target.
+ *
+ * Every primitive clips against it once and then writes without checks;
+ * vg_set_target() resets it to the whole target.
+ *
+ * @param rect rectangle to draw in (x2 and y2 exclusive), NULL for the whole target
+ */
+void vg_set_clip(const vg_rect_t *rect);
+/**
+ * @brief Get the current clip rectangle.
+ *
+ * @param rect where to store it
+ */
+void vg_get_clip(vg_rect_t *rect);
 /**
  * @brief Swap two values.
  *
@@ -33,7 +262,7 @@ void swap(unsigned int *a, unsigned int *b);
  */
 int vg_fill(unsigned int color);
 /**
- * @brief Set a pixel in the position (x,y).
+ * @brief Set a pixel in the position (x,y), unless it is outside the clip rectangle.
  *
  * @param x x coordinate
  * @param y y coordinate
@@ -41,16 +270,74 @@ int vg_fill(unsigned int color);
  */
 int vg_set_pixel(unsigned int x, unsigned int y, unsigned int color);
 /**
- * @brief Get the color of the pixel in the position (x,y).
+ * @brief Get the pixel in the position (x,y) of the video buffer.
+ *
+ * Reads what has been drawn, presented or not; VRAM is never read.
  *
  * @param x x coordinate
  * @param y y coordinate
+ *
+ * @return pixel value, in the format's layout; -1 outside of the buffer
  */
 unsigned long vg_get_pixel(unsigned int x, unsigned int y);
+/**
+ * @brief Get the pixel in the position (x,y) of a surface.
+ *
+ * @param surface surface to read, NULL for the video buffer
+ * @param x x coordinate
+ * @param y y coordinate
+ *
+ * @return pixel value, in the format's layout; -1 outside of the surface
+ */
+unsigned long vg_surface_get_pixel(const vg_surface_t *surface, unsigned int x, unsigned int y);
 /**
  * @brief Transpose the video buffer to the video memory.
+ *
+ * With VG_PRESENT_DAMAGE only the regions damaged since the last call are
+ * copied, unless the damage covers more than VG_DAMAGE_FULL_PERCENT of the screen.
+ * With VG_PRESENT_DIFF the whole buffer is compared with a shadow copy of VRAM
+ * and only the blocks that differ are copied.
  */
 int vg_draw_buffer_to_mem();
+/**
+ * @brief Select how vg_draw_buffer_to_mem() finds what to copy. Defaults to VG_PRESENT_DAMAGE.
+ *
+ * VG_PRESENT_DIFF keeps a shadow copy of VRAM, as large as the video buffer;
+ * the first present after selecting it is whole.
+ *
+ * @param mode one of the present modes
+ *
+ * @return 0 if success, -1 otherwise
+ */
+int vg_set_present_mode(unsigned int mode);
+/**
+ * @brief Get the selected present mode.
+ *
+ * @return one of the present modes
+ */
+unsigned int vg_get_present_mode();
+/**
+ * @brief Mark a region of the video buffer as changed.
+ *
+ * Every vg_* primitive does this on its own; it is only needed after writing
+ * to the buffer by other means.
+ *
+ * @param x1 region's x initial coordinate
+ * @param y1 region's y initial coordinate
+ * @param x2 region's x final coordinate (exclusive)
+ * @param y2 region's y final coordinate (exclusive)
+ */
+void vg_mark_damage(int x1, int y1, int x2, int y2);
+/**
+ * @brief Mark the whole video buffer as changed.
+ */
+void vg_mark_damage_all();
+/**
+ * @brief Get the statistics of the last vg_draw_buffer_to_mem() call.
+ *
+ * @return pointer to the statistics
+ */
+const vg_present_stats_t *vg_get_present_stats();
 /**
  * @brief Draw a number in the video buffer.
  *
@@ -82,7 +369,65 @@ int vg_draw_special(const unsigned int xi, const unsigned int yi, const unsigned
  */
 int vg_draw_char(const unsigned int xi, const unsigned int yi, const unsigned int color, const char symbol, const unsigned int size);
 /**
- * @brief Draw a line in the video buffer.
+ * @brief Get the size of the box vg_draw_char() draws in.
+ *
+ * @param size size of the char
+ * @param width returns the box width
+ * @param height returns the box height
+ */
+void vg_char_extent(const unsigned int size, unsigned int *width, unsigned int *height);
+/**
+ * @brief Get the size of the box vg_draw_number() draws in.
+ *
+ * @param size size of the number
+ * @param width returns the box width
+ * @param height returns the box height
+ */
+void vg_number_extent(const unsigned int size, unsigned int *width, unsigned int *height);
+/**
+ * @brief Draw a run-length image in the video buffer, clipped to the screen.
+ *
+ * @param x image's x coordinate (left)
+ * @param y image's y coordinate (top)
+ * @param image runs to draw
+ */
+int vg_draw_runs(int x, int y, const vg_runs_t *image);
+/**
+ * @brief Copy a whole surface to the video buffer, clipped to the screen.
+ *
+ * @param surface surface to copy
+ * @param x surface's x coordinate (left)
+ * @param y surface's y coordinate (top)
+ */
+int vg_blit_surface(const vg_surface_t *surface, int x, int y);
+/**
+ * @brief Copy a section of the surface being drawn to (the video buffer by default) to a whole surface, clipped to it.
+ *
+ * Pixels of the surface outside the screen are left untouched. Nothing is marked as damaged.
+ *
+ * @param surface surface to copy to
+ * @param x section's x coordinate (left)
+ * @param y section's y coordinate (top)
+ */
+int vg_read_surface(vg_surface_t *surface, int x, int y);
+/**
+ * @brief Copy a rectangle of a surface to memory, e.g. for a screenshot.
+ *
+ * The rectangle is copied at the surface's resolution: every buffer pixel it
+ * touches, (x2 - x1) / vg_get_render_scale() of them per row when the edges are
+ * multiples of the scale. Pixels of the destination outside of the surface are
+ * left untouched. Rows of the whole surface with the surface's pitch are one block copy.
+ *
+ * @param source surface to copy from, NULL for the video buffer
+ * @param rect rectangle to copy (x2 and y2 exclusive)
+ * @param pixels where to copy to, in the surface's pixel format
+ * @param pixels_pitch bytes from the start of a row of pixels to the start of the next
+ *
+ * @return 0 if success, -1 for an empty rectangle
+ */
+int vg_read_rect(const vg_surface_t *source, const vg_rect_t *rect, unsigned char *pixels, unsigned long pixels_pitch);
+/**
+ * @brief Draw a line in the video buffer, clipped to the clip rectangle.
  *
  * @param xi line's x initial coordinate
  * @param yi line's y initial coordinate
@@ -90,7 +435,7 @@ int vg_draw_char(const unsigned int xi, const unsigned int yi, const unsigned in
  * @param yf line's y final coordinate
  * @param color color of the line
  */
-int vg_draw_line(unsigned int xi, unsigned int yi, unsigned int xf, unsigned int yf, unsigned int color);
+int vg_draw_line(int xi, int yi, int xf, int yf, unsigned int color);
 /**
  * @brief Draw a square in the video buffer.
  *
@@ -129,5 +474,37 @@ int vg_draw_death_square(unsigned int xi, unsigned int yi, unsigned int size, un
  * @param color color to fill
  */
 int vg_fill_section(unsigned int xi, unsigned int yi, unsigned int xf, unsigned int yf, unsigned int color);
+/**
+ * @brief Fill a rectangle of the video buffer with a color.
+ *
+ * The rectangle is clipped to the screen once and each row is filled with wide stores.
+ *
+ * @param x1 rectangle's x initial coordinate
+ * @param y1 rectangle's y initial coordinate
+ * @param x2 rectangle's x final coordinate (exclusive)
+ * @param y2 rectangle's y final coordinate (exclusive)
+ * @param color color to fill
+ */
+int vg_fill_rect(int x1, int y1, int x2, int y2, unsigned int color);
+/**
+ * @brief Fill a convex polygon of the video buffer with a color.
+ *
+ * The polygon is closed: every pixel on or inside its edges is filled, so
+ * polygons sharing an edge overlap on it. Degenerate polygons (lines, points) are allowed.
+ *
+ * @param points polygon vertices, in order
+ * @param count number of vertices
+ * @param color color to fill
+ */
+int vg_fill_polygon(const vg_point_t *points, unsigned int count, unsigned int color);
+/**
+ * @brief Fill several rectangles of the video buffer, each with its own color.
+ *
+ * Rectangles are filled in order, so later ones cover earlier ones.
+ *
+ * @param fills array of rectangles and colors
+ * @param count number of elements in fills
+ */
+int vg_fill_rects(const vg_fill_t *fills, unsigned int count);
 
 #endif /* VIDEO_GR_H_ */